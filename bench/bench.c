@@ -0,0 +1,752 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "formats.h"
+#include "matrix_io.h"
+#include "spmv.h"
+#include "sell.h"
+#include "spgemm.h"
+#include "sptrsv.h"
+#include "symmetric.h"
+#include "reorder.h"
+#include "bsr.h"
+#include "generators.h"
+#include "raster.h"
+#include "spmm.h"
+#include "delta.h"
+#include "cg.h"
+#include "stream.h"
+#include "instrument.h"
+
+/**
+ * Benchmark of the library kernels on synthetic (or Matrix Market) matrices.
+ *
+ * ./bin/bench [--sizes 250000,1000000] [--threads 1,2,4] [--reps 10] [--warmup 2]
+ *             [--workloads laplace2d,laplace3d,random,rmat,fem] [--matrix file.mtx] [--kernels spmv_CSR,transpose_CSR]
+ *             [--format csv|json] [--baseline previous.csv] [--tolerance 0.10] [--profile text|json]
+ *
+ * The synthetic workloads have about the requested number of rows each.
+ * Every kernel runs warmup times, then reps timed times; the median, 95th percentile and minimum
+ * times are reported, with the effective bandwidth (bytes of the input read once plus the output
+ * written once, divided by the median time) and the number of nonzero entries processed per second
+ * (k entries per matrix entry for a block of k vectors, one per SpMV for the solver).
+ * With --baseline, the medians are compared with a CSV file written by an earlier run, and the
+ * kernels slower by more than the tolerance are flagged; the exit status is then 1.
+ * stream_spmv runs on a copy of the matrix written to a temporary binary container, read back in
+ * about eight row panels; its result is checked against spmv_CSR at setup, and a mismatch
+ * fails the run.
+ * With --profile, the per-operation counters of a library built with SPARSE_INSTRUMENT
+ * (setup included) are written to stderr at the end of the run.
+ */
+
+#define MAX_LIST 			16
+#define MAX_BASELINE 		4096
+#define SPMM_BENCH_K 		8
+#define CG_BENCH_ITERATIONS 	20
+
+
+//Matrix under test, with the derived forms needed by the kernels, all built once
+typedef struct {
+	char 				name[64];
+	SparseMatrix 		CSR;
+	SparseMatrix 		CSC;
+	SparseMatrix 		COO;
+	SparseMatrix 		shuffled;		//COO entries in random order
+	SparseMatrix 		lower;
+	TriangularSchedule 	lower_schedule;
+	int 				has_schedule;
+	SellMatrix 			SELL;
+	SymmetricMatrix 	SYM;
+	int 				has_symmetric;
+	BsrMatrix 			BSR;
+	DeltaMatrix 		DELTA[3];		//one per value precision
+	CgWorkspace 		cg;				//Jacobi PCG of CG_BENCH_ITERATIONS iterations
+	int 				has_cg;
+	StreamedMatrix 		stream;			//copy of CSR in an unlinked temporary container file
+	int 				has_stream;
+	index_t 			*perm;
+	double 				*x;
+	double 				*y;
+	double 				*X;				//row-major blocks of SPMM_BENCH_K vectors
+	double 				*Y;
+	SparseMatrix 		out;			//output of the timed kernel, released after timing
+	int 				has_out;
+} Workload;
+
+
+typedef struct {
+	const char 	*name;
+	void 		(*run)(Workload *w);
+	double 		(*bytes)(const Workload *w);
+	int 		nnz_factor; 		//nonzero entries processed per entry of the matrix, 1 if left out
+} Kernel;
+
+
+//Sizes in bytes of the storage formats
+static double CSR_bytes(const SparseMatrix *m) {
+	return (double)(m->nr + 1) * INDEX_SIZE + (double)m->nnz * (INDEX_SIZE + DOUBLE_SIZE);
+}
+
+static double CSC_bytes(const SparseMatrix *m) {
+	return (double)(m->nc + 1) * INDEX_SIZE + (double)m->nnz * (INDEX_SIZE + DOUBLE_SIZE);
+}
+
+static double COO_bytes(const SparseMatrix *m) {
+	return (double)m->nnz * (2 * INDEX_SIZE + DOUBLE_SIZE);
+}
+
+static double vectors_bytes(const SparseMatrix *m) {
+	return (double)(m->nr + m->nc) * DOUBLE_SIZE;
+}
+
+
+//Kernels: each one runs the library function once; conversions leave their output in w->out
+static void run_COO_to_CSR(Workload *w) 			{ convert_COO_to_CSR(&w->COO, &w->out); w->has_out = 1; }
+static void run_unsorted_COO_to_CSR(Workload *w) 	{ convert_unsorted_COO_to_CSR(&w->shuffled, &w->out, 1); w->has_out = 1; }
+static void run_CSR_to_COO(Workload *w) 			{ convert_CSR_to_COO(&w->CSR, &w->out); w->has_out = 1; }
+static void run_CSR_to_CSC(Workload *w) 			{ convert_CSR_to_CSC(&w->CSR, &w->out); w->has_out = 1; }
+static void run_CSC_to_CSR(Workload *w) 			{ convert_CSC_to_CSR(&w->CSC, &w->out); w->has_out = 1; }
+static void run_CSR_to_CSC_parallel(Workload *w) 	{ convert_CSR_to_CSC_parallel(&w->CSR, &w->out); w->has_out = 1; }
+static void run_CSC_to_CSR_parallel(Workload *w) 	{ convert_CSC_to_CSR_parallel(&w->CSC, &w->out); w->has_out = 1; }
+static void run_transpose(Workload *w) 				{ transpose_CSR(&w->CSR, &w->out); w->has_out = 1; }
+static void run_transpose_parallel(Workload *w) 	{ transpose_CSR_parallel(&w->CSR, &w->out); w->has_out = 1; }
+static void run_extract_upper(Workload *w) 			{ extract_upper_triangular(&w->CSR, &w->out); w->has_out = 1; }
+static void run_extract_lower(Workload *w) 			{ extract_lower_triangular(&w->CSR, &w->out); w->has_out = 1; }
+static void run_permute(Workload *w) 				{ permute_CSR(w->perm, &w->CSR, w->perm, &w->out); w->has_out = 1; }
+static void run_spgemm(Workload *w) 				{ spgemm(&w->CSR, &w->CSR, &w->out); w->has_out = 1; }
+//The in-place kernels run in pairs that restore their input: a round trip, or two transpositions
+static void run_move_round_trip(Workload *w) 		{ convert_COO_to_CSR_move(&w->COO, &w->COO); convert_CSR_to_COO_move(&w->COO, &w->COO); }
+static void run_transpose_inplace(Workload *w) 		{ if (transpose_CSR_inplace(&w->CSR) == 0) { transpose_CSR_inplace(&w->CSR); } }
+static void run_is_symmetric(Workload *w) 			{ (void)is_symmetric(&w->CSR); }
+static void run_spmv(Workload *w) 					{ spmv_CSR(&w->CSR, w->x, w->y); }
+static void run_spmv_merge_path(Workload *w) 		{ spmv_CSR_merge_path(&w->CSR, w->x, w->y); }
+static void run_spmv_SELL(Workload *w) 				{ spmv_SELL(&w->SELL, w->x, w->y); }
+static void run_spmv_BSR(Workload *w) 				{ spmv_BSR(&w->BSR, w->x, w->y); }
+static void run_spmv_DELTA_double(Workload *w) 		{ spmv_DELTA(&w->DELTA[VALUE_DOUBLE], w->x, w->y); }
+static void run_spmv_DELTA_float(Workload *w) 		{ spmv_DELTA(&w->DELTA[VALUE_FLOAT], w->x, w->y); }
+static void run_spmv_DELTA_bf16(Workload *w) 		{ spmv_DELTA(&w->DELTA[VALUE_BF16], w->x, w->y); }
+static void run_spmv_symmetric(Workload *w) 		{ spmv_symmetric(&w->SYM, w->x, w->y); }
+static void run_sptrsv(Workload *w) 				{ sptrsv_solve(&w->lower, &w->lower_schedule, w->x, w->y); }
+
+static void run_spmm(Workload *w) 					{ spmm_CSR(&w->CSR, LAYOUT_ROW_MAJOR, SPMM_BENCH_K, w->X, SPMM_BENCH_K, w->Y, SPMM_BENCH_K); }
+
+//A zero tolerance makes every solve run the same number of iterations
+static void run_cg(Workload *w) {
+
+	CgResult result;
+	memset(w->y, 0, w->CSR.nr * DOUBLE_SIZE);
+	(void)cg_solve(&w->CSR, &w->cg, w->x, w->y, 0.0, &result);
+}
+
+static void run_stream_spmv(Workload *w) 			{ stream_spmv(&w->stream, w->x, w->y); }
+
+static void run_density_grid(Workload *w) {
+
+	DensityGrid grid;
+	if (compute_density_grid(&w->CSR, 1024, 1024, &grid) == 0) {
+		deallocate_density_grid(&grid);
+	}
+}
+
+static double bytes_COO_CSR(const Workload *w) 		{ return COO_bytes(&w->CSR) + CSR_bytes(&w->CSR); }
+static double bytes_CSR_CSC(const Workload *w) 		{ return CSR_bytes(&w->CSR) + CSC_bytes(&w->CSR); }
+static double bytes_CSR_CSR(const Workload *w) 		{ return 2 * CSR_bytes(&w->CSR); }
+static double bytes_move(const Workload *w) 		{ return 2 * (double)(w->CSR.nr + 1 + 2 * (double)w->CSR.nnz) * INDEX_SIZE; }
+static double bytes_CSR_CSR_twice(const Workload *w) { return 4 * CSR_bytes(&w->CSR); }
+static double bytes_triangle(const Workload *w) 	{ return CSR_bytes(&w->CSR) + CSR_bytes(&w->lower); }
+static double bytes_symmetric(const Workload *w) 	{ return CSR_bytes(&w->CSR); }
+static double bytes_spgemm(const Workload *w) 		{ return 2 * CSR_bytes(&w->CSR) + (w->has_out ? CSR_bytes(&w->out) : 0); }
+static double bytes_spmv(const Workload *w) 		{ return CSR_bytes(&w->CSR) + vectors_bytes(&w->CSR); }
+static double bytes_spmv_symmetric(const Workload *w) { return CSR_bytes(&w->SYM.upper) + vectors_bytes(&w->CSR); }
+static double bytes_sptrsv(const Workload *w) 		{ return CSR_bytes(&w->lower) + vectors_bytes(&w->lower); }
+static double bytes_spmm(const Workload *w) 		{ return CSR_bytes(&w->CSR) + SPMM_BENCH_K * vectors_bytes(&w->CSR); }
+static double bytes_cg(const Workload *w) 			{ return (CG_BENCH_ITERATIONS + 1) * (CSR_bytes(&w->CSR) + 13.0 * w->CSR.nr * DOUBLE_SIZE); }
+static double bytes_pattern(const Workload *w) 		{ return (double)(w->CSR.nr + 1 + w->CSR.nnz) * INDEX_SIZE; }
+
+static double bytes_spmv_SELL(const Workload *w) {
+	return (double)w->SELL.slice_ptr[w->SELL.nslices] * (INDEX_SIZE + DOUBLE_SIZE) + vectors_bytes(&w->CSR);
+}
+
+static double bytes_spmv_DELTA_double(const Workload *w) { return DELTA_bytes(&w->DELTA[VALUE_DOUBLE]) + vectors_bytes(&w->CSR); }
+static double bytes_spmv_DELTA_float(const Workload *w) { return DELTA_bytes(&w->DELTA[VALUE_FLOAT]) + vectors_bytes(&w->CSR); }
+static double bytes_spmv_DELTA_bf16(const Workload *w) { return DELTA_bytes(&w->DELTA[VALUE_BF16]) + vectors_bytes(&w->CSR); }
+
+static double bytes_spmv_BSR(const Workload *w) {
+	return (double)w->BSR.nnzb * (INDEX_SIZE + (double)w->BSR.r * w->BSR.c * DOUBLE_SIZE) + vectors_bytes(&w->CSR);
+}
+
+
+static const Kernel kernels[] = {
+	{"convert_COO_to_CSR", 				run_COO_to_CSR, 			bytes_COO_CSR},
+	{"convert_unsorted_COO_to_CSR", 	run_unsorted_COO_to_CSR, 	bytes_COO_CSR},
+	{"convert_CSR_to_COO", 				run_CSR_to_COO, 			bytes_COO_CSR},
+	{"convert_CSR_to_CSC", 				run_CSR_to_CSC, 			bytes_CSR_CSC},
+	{"convert_CSC_to_CSR", 				run_CSC_to_CSR, 			bytes_CSR_CSC},
+	{"convert_CSR_to_CSC_parallel", 	run_CSR_to_CSC_parallel, 	bytes_CSR_CSC},
+	{"convert_CSC_to_CSR_parallel", 	run_CSC_to_CSR_parallel, 	bytes_CSR_CSC},
+	{"transpose_CSR", 					run_transpose, 				bytes_CSR_CSR},
+	{"transpose_CSR_parallel", 			run_transpose_parallel, 	bytes_CSR_CSR},
+	{"transpose_CSR_inplace_twice", 	run_transpose_inplace, 		bytes_CSR_CSR_twice},
+	{"COO_CSR_move_round_trip", 		run_move_round_trip, 		bytes_move},
+	{"is_symmetric", 					run_is_symmetric, 			bytes_symmetric},
+	{"extract_upper_triangular", 		run_extract_upper, 			bytes_triangle},
+	{"extract_lower_triangular", 		run_extract_lower, 			bytes_triangle},
+	{"permute_CSR", 					run_permute, 				bytes_CSR_CSR},
+	{"spgemm", 							run_spgemm, 				bytes_spgemm},
+	{"spmv_CSR", 						run_spmv, 					bytes_spmv},
+	{"spmv_CSR_merge_path", 			run_spmv_merge_path, 		bytes_spmv},
+	{"spmv_SELL", 						run_spmv_SELL, 				bytes_spmv_SELL},
+	{"spmv_BSR", 						run_spmv_BSR, 				bytes_spmv_BSR},
+	{"spmv_DELTA_double", 				run_spmv_DELTA_double, 		bytes_spmv_DELTA_double},
+	{"spmv_DELTA_float", 				run_spmv_DELTA_float, 		bytes_spmv_DELTA_float},
+	{"spmv_DELTA_bf16", 				run_spmv_DELTA_bf16, 		bytes_spmv_DELTA_bf16},
+	{"spmv_symmetric", 					run_spmv_symmetric, 		bytes_spmv_symmetric},
+	{"sptrsv_solve", 					run_sptrsv, 				bytes_sptrsv},
+	{"spmm_CSR_k8", 					run_spmm, 					bytes_spmm, 			SPMM_BENCH_K},
+	{"cg_jacobi_20_iterations", 		run_cg, 					bytes_cg, 				CG_BENCH_ITERATIONS + 1},
+	{"stream_spmv", 					run_stream_spmv, 			bytes_spmv},
+	{"compute_density_grid", 			run_density_grid, 			bytes_pattern},
+};
+
+#define NUM_KERNELS 	((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+
+static int 	stream_failures = 0;
+
+
+static double wall_time(void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+/**
+ * Writes w->CSR to a temporary container and opens it for streaming, with a budget of about
+ * eight panels, then checks a streamed SpMV against spmv_CSR.
+ * @return	1 if the streamed matrix is ready, 0 otherwise.*/
+static int prepare_stream(Workload *w) {
+
+	const SparseMatrix *A = &w->CSR;
+
+	//Every panel buffer must hold the longest row
+	index_t max_row = 0;
+	for (index_t i = 0; i < A->nr; i++) {
+		max_row = (A->ia[i + 1] - A->ia[i] > max_row) ? A->ia[i + 1] - A->ia[i] : max_row;
+	}
+	size_t budget 		= (size_t)(CSR_bytes(A) / 2);
+	size_t min_budget 	= 4 * (2 * INDEX_SIZE + (size_t)max_row * (INDEX_SIZE + DOUBLE_SIZE));
+	budget 				= (budget > min_budget) ? budget : min_budget;
+
+	const char *dir = getenv("TMPDIR");
+	char filename[512];
+	snprintf(filename, sizeof(filename), "%s/sparse_bench_XXXXXX", dir ? dir : "/tmp");
+	int fd = mkstemp(filename);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot create a temporary file for stream_spmv.\n");
+		return 0;
+	}
+	close(fd);
+
+	//The open descriptor keeps the data of the unlinked file
+	int status = write_binary_matrix(filename, A, FORMAT_CSR);
+	if (status == 0) {
+		status = open_streamed_matrix(filename, budget, &w->stream);
+	}
+	unlink(filename);
+	if (status != 0) {
+		return 0;
+	}
+
+	double *y = malloc(A->nr * DOUBLE_SIZE);
+	IS_POINTER_VALID(y);
+	spmv_CSR(A, w->x, w->y);
+	status = stream_spmv(&w->stream, w->x, y);
+	for (index_t i = 0; (status == 0) && (i < A->nr); i++) {
+		if (fabs(y[i] - w->y[i]) > 1e-12 * (1.0 + fabs(w->y[i]))) {
+			fprintf(stderr, "stream_spmv differs from spmv_CSR in row " INDEX_FMT " of %s: %g instead of %g.\n",
+					i, w->name, y[i], w->y[i]);
+			status = -1;
+		}
+	}
+	free(y);
+
+	if (status != 0) {
+		stream_failures++;
+		close_streamed_matrix(&w->stream);
+		return 0;
+	}
+	return 1;
+}
+
+
+//Builds the derived forms of w->CSR used by the kernels
+static void prepare_workload(Workload *w) {
+
+	SparseMatrix *A = &w->CSR;
+
+	convert_CSR_to_CSC(A, &w->CSC);
+	convert_CSR_to_COO(A, &w->COO);
+
+	w->shuffled.nr 	= A->nr;
+	w->shuffled.nc 	= A->nc;
+	w->shuffled.nnz = A->nnz;
+	allocate_COO_matrix(&w->shuffled);
+	memcpy(w->shuffled.ia, w->COO.ia, A->nnz * INDEX_SIZE);
+	memcpy(w->shuffled.ja, w->COO.ja, A->nnz * INDEX_SIZE);
+	memcpy(w->shuffled.a, w->COO.a, A->nnz * DOUBLE_SIZE);
+
+	uint64_t state = 42;
+	for (index_t k = A->nnz - 1; k > 0; k--) {
+		state 		= state * 6364136223846793005ULL + 1442695040888963407ULL;
+		index_t m 	= (index_t)((state >> 16) % (uint64_t)(k + 1));
+		index_t ti 	= w->shuffled.ia[k]; w->shuffled.ia[k] = w->shuffled.ia[m]; w->shuffled.ia[m] = ti;
+		index_t tj 	= w->shuffled.ja[k]; w->shuffled.ja[k] = w->shuffled.ja[m]; w->shuffled.ja[m] = tj;
+		double 	ta 	= w->shuffled.a[k];  w->shuffled.a[k]  = w->shuffled.a[m];  w->shuffled.a[m]  = ta;
+	}
+
+	extract_lower_triangular(A, &w->lower);
+	w->has_schedule 	= (sptrsv_analysis(&w->lower, TRIANGLE_LOWER, 0, &w->lower_schedule) == 0);
+	w->has_symmetric 	= (convert_CSR_to_symmetric(A, &w->SYM, 0.0) == 0);
+
+	convert_CSR_to_SELL(A, &w->SELL, SELL_DEFAULT_C, SELL_DEFAULT_SIGMA);
+
+	int b = select_BSR_block_size(A);
+	if ((b == 1) && (A->nr % 2 == 0) && (A->nc % 2 == 0)) {
+		b = 2;
+	}
+	convert_CSR_to_BSR(A, &w->BSR, b, b);
+
+	for (int p = VALUE_DOUBLE; p <= VALUE_BF16; p++) {
+		convert_CSR_to_DELTA(A, &w->DELTA[p], (ValuePrecision)p);
+	}
+
+	w->has_cg = w->has_symmetric && (init_cg_workspace(A, PRECONDITIONER_JACOBI, CG_BENCH_ITERATIONS, &w->cg) == 0);
+
+	w->perm = malloc(A->nr * INDEX_SIZE);
+	IS_POINTER_VALID(w->perm);
+	if (compute_RCM_ordering(A, w->perm) != 0) {
+		for (index_t i = 0; i < A->nr; i++) {
+			w->perm[i] = i;
+		}
+	}
+
+	w->x = malloc(A->nc * DOUBLE_SIZE);
+	w->y = malloc(A->nr * DOUBLE_SIZE);
+	IS_POINTER_VALID(w->x);
+	IS_POINTER_VALID(w->y);
+	for (index_t i = 0; i < A->nc; i++) {
+		w->x[i] = 1.0 + (double)(i % 7);
+	}
+
+	w->X = malloc((size_t)A->nc * SPMM_BENCH_K * DOUBLE_SIZE);
+	w->Y = malloc((size_t)A->nr * SPMM_BENCH_K * DOUBLE_SIZE);
+	IS_POINTER_VALID(w->X);
+	IS_POINTER_VALID(w->Y);
+	for (size_t i = 0; i < (size_t)A->nc * SPMM_BENCH_K; i++) {
+		w->X[i] = 1.0 + (double)(i % 5);
+	}
+
+	w->has_stream = prepare_stream(w);
+	w->has_out = 0;
+}
+
+
+static void release_workload(Workload *w) {
+
+	deallocate_sparse_matrix(&w->CSR);
+	deallocate_sparse_matrix(&w->CSC);
+	deallocate_sparse_matrix(&w->COO);
+	deallocate_sparse_matrix(&w->shuffled);
+	deallocate_sparse_matrix(&w->lower);
+	if (w->has_schedule) {
+		deallocate_triangular_schedule(&w->lower_schedule);
+	}
+	if (w->has_symmetric) {
+		deallocate_symmetric_matrix(&w->SYM);
+	}
+	deallocate_SELL_matrix(&w->SELL);
+	deallocate_BSR_matrix(&w->BSR);
+	for (int p = VALUE_DOUBLE; p <= VALUE_BF16; p++) {
+		deallocate_DELTA_matrix(&w->DELTA[p]);
+	}
+	if (w->has_cg) {
+		deallocate_cg_workspace(&w->cg);
+	}
+	if (w->has_stream) {
+		close_streamed_matrix(&w->stream);
+	}
+	free(w->perm);
+	free(w->x);
+	free(w->y);
+	free(w->X);
+	free(w->Y);
+}
+
+
+//Kernels that cannot run on this matrix
+static int kernel_applicable(const Kernel *k, const Workload *w) {
+
+	if ((k->run == run_spmv_symmetric) && !w->has_symmetric) {
+		return 0;
+	}
+	if ((k->run == run_stream_spmv) && !w->has_stream) {
+		return 0;
+	}
+	if ((k->run == run_cg) && !w->has_cg) {
+		return 0;
+	}
+	if ((k->run == run_sptrsv) && !w->has_schedule) {
+		return 0;
+	}
+	if ((k->run == run_spgemm) && (w->CSR.nr != w->CSR.nc)) {
+		return 0;
+	}
+	return 1;
+}
+
+
+static int compare_times(const void *a, const void *b) {
+
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+
+//Results of an earlier run, read from its CSV output
+typedef struct {
+	char 	key[192];
+	double 	median;
+} BaselineEntry;
+
+static BaselineEntry 	baseline[MAX_BASELINE];
+static int 				baseline_count = 0;
+
+
+static int load_baseline(const char *filename) {
+
+	FILE *file = fopen(filename, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot open baseline '%s'.\n", filename);
+		return -1;
+	}
+
+	char line[512];
+	while (fgets(line, sizeof(line), file) && (baseline_count < MAX_BASELINE)) {
+
+		char workload[64], kernel[64];
+		long long rows, nnz;
+		int threads, reps;
+		double median;
+
+		for (char *p = line; *p; p++) {
+			if (*p == ',') {
+				*p = ' ';
+			}
+		}
+		if (sscanf(line, "%63s %lld %lld %63s %d %d %lf", workload, &rows, &nnz, kernel, &threads, &reps, &median) != 7) {
+			continue;
+		}
+
+		BaselineEntry *e = &baseline[baseline_count++];
+		snprintf(e->key, sizeof(e->key), "%s/%lld/%s/%d", workload, rows, kernel, threads);
+		e->median = median;
+	}
+
+	fclose(file);
+	return 0;
+}
+
+
+static double find_baseline(const char *key) {
+
+	for (int i = 0; i < baseline_count; i++) {
+		if (strcmp(baseline[i].key, key) == 0) {
+			return baseline[i].median;
+		}
+	}
+	return -1.0;
+}
+
+
+//Parses a comma-separated list of integers; returns the number of entries
+static int parse_list(const char *arg, long *values) {
+
+	int n = 0;
+	const char *p = arg;
+	while (*p && (n < MAX_LIST)) {
+		char *end;
+		long v = strtol(p, &end, 10);
+		if (end == p) {
+			break;
+		}
+		values[n++] = v;
+		p = (*end == ',') ? end + 1 : end;
+	}
+	return n;
+}
+
+
+static int name_in_list(const char *name, const char *list) {
+
+	if (list == NULL) {
+		return 1;
+	}
+
+	size_t len = strlen(name);
+	for (const char *p = list; (p = strstr(p, name)) != NULL; p += len) {
+		int starts 	= (p == list) || (p[-1] == ',');
+		int ends 	= (p[len] == '\0') || (p[len] == ',');
+		if (starts && ends) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+typedef struct {
+	int 		reps;
+	int 		warmup;
+	int 		json;
+	double 		tolerance;
+	const char 	*kernel_list;
+	long 		threads[MAX_LIST];
+	int 		nthreads;
+} Options;
+
+
+static int 	first_record 	= 1;
+static int 	regressions 	= 0;
+
+
+static void bench_workload(Workload *w, const Options *opt) {
+
+	double *times = malloc(opt->reps * sizeof(double));
+	IS_POINTER_VALID(times);
+
+	for (int t = 0; t < opt->nthreads; t++) {
+
+		set_num_threads((int)opt->threads[t]);
+
+		for (int k = 0; k < NUM_KERNELS; k++) {
+
+			const Kernel *kernel = &kernels[k];
+			if (!name_in_list(kernel->name, opt->kernel_list) || !kernel_applicable(kernel, w)) {
+				continue;
+			}
+
+			double bytes = 0.0;
+			for (int r = -opt->warmup; r < opt->reps; r++) {
+
+				double start = wall_time();
+				kernel->run(w);
+				double stop = wall_time();
+
+				if (r >= 0) {
+					times[r] = stop - start;
+				}
+				bytes = kernel->bytes(w);
+				if (w->has_out) {
+					deallocate_sparse_matrix(&w->out);
+					w->has_out = 0;
+				}
+			}
+
+			qsort(times, opt->reps, sizeof(double), compare_times);
+			double median 	= (opt->reps % 2) ? times[opt->reps / 2] : 0.5 * (times[opt->reps / 2 - 1] + times[opt->reps / 2]);
+			double p95 		= times[(int)(0.95 * (opt->reps - 1) + 0.5)];
+			double gbps 	= bytes / median * 1e-9;
+			double nnzps 	= (double)w->CSR.nnz * (kernel->nnz_factor ? kernel->nnz_factor : 1) / median;
+
+			char key[192];
+			snprintf(key, sizeof(key), "%s/%lld/%s/%ld", w->name, (long long)w->CSR.nr, kernel->name, opt->threads[t]);
+			double base 	= find_baseline(key);
+			double ratio 	= (base > 0) ? median / base : 0.0;
+			const char *status = (base <= 0) ? "" : ((ratio > 1.0 + opt->tolerance) ? "REGRESSION" : "ok");
+			regressions += (base > 0) && (ratio > 1.0 + opt->tolerance);
+
+			if (opt->json) {
+				printf("%s\n  {\"workload\": \"%s\", \"rows\": %lld, \"nnz\": %lld, \"kernel\": \"%s\", \"threads\": %ld, "
+					   "\"reps\": %d, \"median_s\": %.6e, \"p95_s\": %.6e, \"min_s\": %.6e, \"gb_per_s\": %.3f, \"nnz_per_s\": %.4e",
+					   first_record ? "[" : ",", w->name, (long long)w->CSR.nr, (long long)w->CSR.nnz, kernel->name,
+					   opt->threads[t], opt->reps, median, p95, times[0], gbps, nnzps);
+				if (base > 0) {
+					printf(", \"baseline_s\": %.6e, \"ratio\": %.3f, \"status\": \"%s\"", base, ratio, status);
+				}
+				printf("}");
+			}
+			else {
+				printf("%s,%lld,%lld,%s,%ld,%d,%.6e,%.6e,%.6e,%.3f,%.4e", w->name, (long long)w->CSR.nr, (long long)w->CSR.nnz,
+					   kernel->name, opt->threads[t], opt->reps, median, p95, times[0], gbps, nnzps);
+				if (base > 0) {
+					printf(",%.6e,%.3f,%s", base, ratio, status);
+				}
+				printf("\n");
+			}
+			first_record = 0;
+			fflush(stdout);
+
+			if (base > 0 && ratio > 1.0 + opt->tolerance) {
+				fprintf(stderr, "Regression: %s is %.1f%% slower than the baseline.\n", key, 100.0 * (ratio - 1.0));
+			}
+		}
+	}
+
+	free(times);
+}
+
+
+int main(int argc, char const *argv[]) {
+
+	Options opt;
+	opt.reps 		= 10;
+	opt.warmup 		= 2;
+	opt.json 		= 0;
+	opt.tolerance 	= 0.10;
+	opt.kernel_list = NULL;
+	opt.threads[0] 	= get_max_threads();
+	opt.nthreads 	= 1;
+
+	long sizes[MAX_LIST] 		= {1000000};
+	int nsizes 					= 1;
+	const char *workloads 		= "laplace2d,random";
+	const char *matrix_file 	= NULL;
+	const char *baseline_file 	= NULL;
+	const char *profile 		= NULL;
+
+	for (int i = 1; i < argc; i++) {
+
+		const char *arg 	= argv[i];
+		const char *value 	= (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		if (value == NULL) {
+			fprintf(stderr, "Missing value for option '%s'.\n", arg);
+			return EXIT_FAILURE;
+		}
+		i++;
+
+		if (strcmp(arg, "--sizes") == 0) 			{ nsizes = parse_list(value, sizes); }
+		else if (strcmp(arg, "--threads") == 0) 	{ opt.nthreads = parse_list(value, opt.threads); }
+		else if (strcmp(arg, "--reps") == 0) 		{ opt.reps = atoi(value); }
+		else if (strcmp(arg, "--warmup") == 0) 		{ opt.warmup = atoi(value); }
+		else if (strcmp(arg, "--workloads") == 0) 	{ workloads = value; }
+		else if (strcmp(arg, "--matrix") == 0) 		{ matrix_file = value; }
+		else if (strcmp(arg, "--kernels") == 0) 	{ opt.kernel_list = value; }
+		else if (strcmp(arg, "--format") == 0) 		{ opt.json = (strcmp(value, "json") == 0); }
+		else if (strcmp(arg, "--baseline") == 0) 	{ baseline_file = value; }
+		else if (strcmp(arg, "--tolerance") == 0) 	{ opt.tolerance = atof(value); }
+		else if (strcmp(arg, "--profile") == 0) 	{ profile = value; }
+		else {
+			fprintf(stderr, "Unknown option '%s'.\n", arg);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((opt.reps < 1) || (opt.warmup < 0) || (opt.nthreads < 1) || (nsizes < 1)) {
+		fprintf(stderr, "Invalid options.\n");
+		return EXIT_FAILURE;
+	}
+	if (baseline_file && (load_baseline(baseline_file) != 0)) {
+		return EXIT_FAILURE;
+	}
+
+	if (!opt.json) {
+		printf("workload,rows,nnz,kernel,threads,reps,median_s,p95_s,min_s,gb_per_s,nnz_per_s%s\n",
+			   baseline_file ? ",baseline_s,ratio,status" : "");
+	}
+
+	Workload w;
+
+	if (matrix_file) {
+		if (read_matrix_market_CSR(matrix_file, &w.CSR) != 0) {
+			return EXIT_FAILURE;
+		}
+		const char *base = strrchr(matrix_file, '/');
+		snprintf(w.name, sizeof(w.name), "%s", base ? base + 1 : matrix_file);
+		prepare_workload(&w);
+		bench_workload(&w, &opt);
+		release_workload(&w);
+	}
+	else {
+		static const char *names[] = {"laplace2d", "laplace3d", "random", "rmat", "fem"};
+
+		for (int s = 0; s < nsizes; s++) {
+			for (int k = 0; k < (int)(sizeof(names) / sizeof(names[0])); k++) {
+
+				if (!name_in_list(names[k], workloads)) {
+					continue;
+				}
+
+				index_t n 	= (index_t)sizes[s];
+				int status 	= 0;
+				switch (k) {
+					case 0: status = generate_laplacian_2d((index_t)sqrt((double)n), (index_t)sqrt((double)n), &w.CSR); break;
+					case 1: status = generate_laplacian_3d((index_t)cbrt((double)n), (index_t)cbrt((double)n), (index_t)cbrt((double)n), 27, &w.CSR); break;
+					case 2: status = generate_random_uniform(n, n, 8.0, 1, &w.CSR); break;
+					case 3: status = generate_rmat((int)ceil(log2((double)n)), 8.0, 0.57, 0.19, 0.19, 1, &w.CSR); break;
+					case 4: status = generate_fem_blocks_2d((index_t)sqrt(n / 3.0), (index_t)sqrt(n / 3.0), 3, &w.CSR); break;
+				}
+				if (status != 0) {
+					fprintf(stderr, "Cannot generate the %s workload of size %ld.\n", names[k], sizes[s]);
+					return EXIT_FAILURE;
+				}
+
+				snprintf(w.name, sizeof(w.name), "%s", names[k]);
+				prepare_workload(&w);
+				bench_workload(&w, &opt);
+				release_workload(&w);
+			}
+		}
+	}
+
+	if (opt.json) {
+		printf("%s\n", first_record ? "[]" : "\n]");
+	}
+
+	if (profile) {
+		if (strcmp(profile, "json") == 0) {
+			instrument_dump_json(stderr);
+		}
+		else {
+			instrument_dump(stderr);
+		}
+	}
+
+	return ((regressions > 0) || (stream_failures > 0)) ? 1 : EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BSR_H
+#define BSR_H
+
+#include "formats.h"
+#include "parallel.h"
+
+//Largest block dimension tried by select_BSR_block_size
+#define BSR_MAX_BLOCK_SIZE 	8
+
+
+/**
+ * Block Compressed Sparse Row (BSR) storage.
+ * The matrix is split into dense r x c blocks, and the blocks holding at least one nonzero entry
+ * are stored in CSR fashion: one column index per block instead of one per entry, which cuts the
+ * index traffic by a factor r*c. The values of a block are stored row-major, with explicit zeros
+ * where the block is not full. The last block row and column are padded with zeros if r and c
+ * do not divide nr and nc.
+ * */
+typedef struct {
+	index_t 	nr;				//number of rows
+	index_t 	nc;				//number of columns
+	index_t 	nnz;			//number of nonzero entries of the original matrix
+	int 		r;				//block height
+	int 		c;				//block width
+	index_t 	nbr;			//number of block rows, ceil(nr / r)
+	index_t 	nbc;			//number of block columns, ceil(nc / c)
+	index_t 	nnzb;			//number of stored blocks
+	index_t 	*ia;			//block row pointer array, length (nbr + 1)
+	index_t 	*ja;			//block column index array, length nnzb, sorted within each block row
+	double 		*a;				//block values, r * c per block, length (nnzb * r * c)
+} BsrMatrix;
+
+
+/**
+ * @return	the fill ratio of the r x c block structure of a CSR matrix, i.e. the number of stored
+ * 			values (explicit zeros included) divided by nnz, without building the blocks.
+ * */
+double 	BSR_fill_ratio(const SparseMatrix *CSR, int r, int c);
+
+
+/**
+ * @brief	Chooses the square block size, up to BSR_MAX_BLOCK_SIZE and among the sizes dividing
+ * 			both dimensions, that minimizes the number of bytes read by the SpMV, values and
+ * 			indices included, as estimated from the fill ratio. 1 means that CSR is preferable.
+ * */
+int 	select_BSR_block_size(const SparseMatrix *CSR);
+
+
+/**
+ * @brief	Converts a CSR matrix into BSR format with r x c blocks. The block rows are built in parallel.
+ * */
+void 	convert_CSR_to_BSR(const SparseMatrix *CSR, BsrMatrix *BSR, int r, int c);
+
+
+/**
+ * @brief	Converts a BSR matrix back into CSR format. The explicit zeros of the blocks are dropped,
+ * 			so the round trip is exact for a matrix without explicitly stored zeros.
+ * */
+void 	convert_BSR_to_CSR(const BsrMatrix *BSR, SparseMatrix *CSR);
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x for a BSR matrix. Square blocks of size 2, 3, 4, 6
+ * 			and 8 use fully unrolled kernels when the block size divides both dimensions;
+ * 			other shapes use a generic kernel.
+ * */
+void 	spmv_BSR(const BsrMatrix *BSR, const double *x, double *y);
+
+
+void 	deallocate_BSR_matrix(BsrMatrix *BSR);
+
+
+#endif
@@ -0,0 +1,113 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CG_H
+#define CG_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+typedef enum {
+	PRECONDITIONER_NONE,
+	PRECONDITIONER_JACOBI		//z = D^-1 r, with D the diagonal of the matrix
+} Preconditioner;
+
+
+/**
+ * Work vectors of the (preconditioned) conjugate gradient, allocated once and reused by every
+ * solve with a matrix of the same size; the per-iteration records of the last solve are kept
+ * here as well.
+ * */
+typedef struct {
+	index_t 		n;					//order of the matrix
+	int 			max_iterations;
+	Preconditioner 	preconditioner;
+	double 			*r;					//residual b - A*x
+	double 			*z;					//preconditioned residual; aliases r without preconditioner
+	double 			*p;					//search direction
+	double 			*Ap;				//A*p
+	double 			*inv_diag;			//inverse of the diagonal, for the Jacobi preconditioner
+	double 			*iteration_time;	//wall time of every iteration, in seconds, length max_iterations
+	double 			*residual_norm;		//||r|| after every iteration, length max_iterations
+} CgWorkspace;
+
+
+typedef struct {
+	int 		iterations;				//iterations performed
+	int 		converged;				//1 if ||r|| <= rtol * ||b|| was reached
+	double 		residual_norm;			//final ||r||, from the recurrence
+	double 		setup_time;				//initial residual and preconditioner application, in seconds
+	double 		solve_time;				//total time, setup included, in seconds
+} CgResult;
+
+
+/**
+ * @brief	Allocates the work vectors for matrices of order n and, for the Jacobi
+ * 			preconditioner, computes the inverse diagonal of CSR.
+ * @return	0 on success, -1 if CSR is not square or has a zero or missing diagonal entry
+ * 			while the Jacobi preconditioner is requested.
+ * */
+int 	init_cg_workspace(const SparseMatrix *CSR, Preconditioner preconditioner, int max_iterations, CgWorkspace *ws);
+
+
+/**
+ * @brief	Recomputes the preconditioner after the values of the matrix have changed.
+ * @return	0 on success, -1 on a zero or missing diagonal entry.
+ * */
+int 	update_cg_preconditioner(const SparseMatrix *CSR, CgWorkspace *ws);
+
+
+/**
+ * @brief	Solves A*x = b for a symmetric positive definite CSR matrix (see is_symmetric) with
+ * 			the conjugate gradient method, preconditioned as set up in ws.
+ * 			Every iteration makes three multithreaded passes over memory: the SpMV computes
+ * 			p.Ap in the same pass, a fused update computes x, r, z, r.z and r.r, and a last pass
+ * 			updates p. The wall time and the residual norm of every iteration are recorded in ws.
+ * @param	x 		: initial guess on input, solution on output
+ * @param	rtol 	: stopping criterion ||r|| <= rtol * ||b||
+ * @return	0 if converged, -1 otherwise (iteration limit, or breakdown of an indefinite matrix).
+ * */
+int 	cg_solve(const SparseMatrix *CSR, CgWorkspace *ws, const double *b, double *x, double rtol, CgResult *result);
+
+
+/**
+ * @brief	Prints the summary of a solve and the time and residual of every iteration.
+ * */
+void 	print_cg_report(const CgWorkspace *ws, const CgResult *result, FILE *out);
+
+
+void 	deallocate_cg_workspace(CgWorkspace *ws);
+
+
+#endif
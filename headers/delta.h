@@ -0,0 +1,118 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include "formats.h"
+#include "parallel.h"
+
+//Rows per chunk sharing one delta width
+#define DELTA_CHUNK_ROWS 	64
+
+//Delta value marking an entry whose column index is stored in full in the escape array
+#define DELTA_ESCAPE 		0
+
+
+//Storage precision of the values; the products are always accumulated in double precision
+typedef enum {
+	VALUE_DOUBLE,
+	VALUE_FLOAT,
+	VALUE_BF16				//bfloat16: the upper 16 bits of a float, 8 significant bits
+} ValuePrecision;
+
+
+/**
+ * Delta-encoded CSR storage, for bandwidth-bound kernels: every nonzero entry costs 1 or 2 bytes
+ * of column index and 8, 4 or 2 bytes of value, instead of INDEX_SIZE + 8 bytes.
+ * Within a row, every column is stored as the difference with the previous one; the first column
+ * of row i is stored as its difference with i - 2^(8w - 1) for w-byte differences, so that it fits
+ * when it lies near the diagonal. The rows are grouped into chunks of DELTA_CHUNK_ROWS rows, and
+ * each chunk stores its differences on 8 or 16 bits, whichever takes fewer bytes. A difference
+ * that does not fit, or is not positive (unsorted columns), is stored as DELTA_ESCAPE, and the
+ * column is taken in full from the escape array.
+ * */
+typedef struct {
+	index_t 		nr;				//number of rows
+	index_t 		nc;				//number of columns
+	index_t 		nnz;			//number of nonzero entries
+	index_t 		nchunks;		//number of row chunks, ceil(nr / DELTA_CHUNK_ROWS)
+	ValuePrecision 	precision;
+	index_t 		*ia;			//row pointers, length (nr + 1)
+	uint8_t 		*width;			//bytes per difference of each chunk, 1 or 2, length nchunks
+	size_t 			*delta_ptr;		//byte offset of the differences of each chunk, length (nchunks + 1)
+	index_t 		*escape_ptr;	//offset of the escaped columns of each chunk, length (nchunks + 1)
+	uint8_t 		*deltas;		//column differences; the chunks start on even offsets
+	index_t 		*escape;		//escaped column indices
+	void 			*a;				//values, in the storage precision
+} DeltaMatrix;
+
+
+/**
+ * @brief	Converts a CSR matrix into the delta-encoded format; the values are rounded to
+ * 			the nearest representable value of the storage precision.
+ * */
+void 	convert_CSR_to_DELTA(const SparseMatrix *CSR, DeltaMatrix *DELTA, ValuePrecision precision);
+
+
+/**
+ * @return	the size in bytes of all the arrays of the matrix.
+ * */
+size_t 	DELTA_bytes(const DeltaMatrix *DELTA);
+
+
+/**
+ * @return	the compression ratio: size of the same matrix in CSR format over DELTA_bytes().
+ * */
+double 	DELTA_compression_ratio(const DeltaMatrix *DELTA);
+
+
+/**
+ * @brief	Prints the compression achieved: sizes, bytes per entry, chunks per width and
+ * 			fraction of escaped entries.
+ * */
+void 	print_DELTA_report(const DeltaMatrix *DELTA, FILE *out);
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x, decoding the columns and values on the fly.
+ * 			The chunks are distributed among the threads so that each thread processes
+ * 			about the same number of nonzero entries.
+ * */
+void 	spmv_DELTA(const DeltaMatrix *DELTA, const double *x, double *y);
+
+
+void 	deallocate_DELTA_matrix(DeltaMatrix *DELTA);
+
+
+#endif
@@ -38,6 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "utilities.h"
 
@@ -45,51 +46,158 @@
 #define INT_SIZE 		sizeof(int)
 #define DOUBLE_SIZE 	sizeof(double)
 
-/**
- * Checks whether memory allocation is successful.
- * The program will terminate in case the memory allocation fails.*/
-#define IS_POINTER_VALID(ptr) 													\
-	if (ptr == NULL) {															\
-		fprintf(stderr, "%s", "Memory allocation failed, aborting...\n");		\
-		exit(EXIT_FAILURE);														\
-	}	
-
 
 typedef struct {
-	int 	nr;				//number of rows and columns; the sparse matrix is assumed to be square.
-	int 	nnz;			//number of nonzero entries
-	int 	*ia;			//row index array (COO and CSC), row pointer array (CSR)
-	int 	*ja;			//column index array (COO and CSR), column pointer array (CSC)
-	double 	*a;
+	index_t 	nr;				//number of rows
+	index_t 	nc;				//number of columns
+	index_t 	nnz;			//number of nonzero entries
+	index_t 	*ia;			//row index array (COO and CSC), row pointer array (CSR)
+	index_t 	*ja;			//column index array (COO and CSR), column pointer array (CSC)
+	double 		*a;
+	void 		*mem;			//aligned block holding ia, ja and a, or NULL if they were allocated separately
+	size_t 		capacity;		//size of the block in bytes
 } SparseMatrix;
 
 
+/**
+ * @brief	The allocation functions store ia, ja and a in one block aligned to MEMORY_ALIGNMENT,
+ * 			each array starting on its own aligned boundary. The arrays are zeroed.
+ * */
 void	allocate_COO_matrix(SparseMatrix *mat);
 
 void	allocate_CSR_matrix(SparseMatrix *mat);
 
 void	allocate_CSC_matrix(SparseMatrix *mat);
 
-void 	count_nonzeros_per_row_CSR(SparseMatrix *CSR, int *nnz_per_row);
+/**
+ * @brief	Marks the matrix as owning no storage block, so that the next reserve_*() call
+ * 			allocates a new one. Call it on matrices that were never allocated.
+ * */
+void 	reset_matrix_storage(SparseMatrix *mat);
+
+/**
+ * @brief	Lays out the arrays of a matrix of the current dimensions in its storage block,
+ * 			reusing the block when its capacity suffices and replacing it otherwise.
+ * 			The previous contents are not preserved.
+ * @param	flags 	: ALLOC_ZERO and/or ALLOC_HUGEPAGES; without ALLOC_ZERO the arrays are left
+ * 					  uninitialized. The default flags (see set_matrix_allocation_flags) are added.
+ * */
+void 	reserve_COO_matrix(SparseMatrix *mat, int flags);
+
+void 	reserve_CSR_matrix(SparseMatrix *mat, int flags);
+
+void 	reserve_CSC_matrix(SparseMatrix *mat, int flags);
+
+/**
+ * @brief	Sets the flags added to every matrix allocation, e.g. ALLOC_HUGEPAGES. Defaults to 0.
+ * */
+void 	set_matrix_allocation_flags(int flags);
 
-void 	count_nonzeros_per_row_COO(SparseMatrix *COO, int *nnz_per_row);
+void 	count_nonzeros_per_row_CSR(SparseMatrix *CSR, index_t *nnz_per_row);
 
+void 	count_nonzeros_per_row_COO(SparseMatrix *COO, index_t *nnz_per_row);
+
+/**
+ * @brief	Sorts the len entries of one row by column index, moving the values along.
+ * */
+void 	sort_row_by_column(index_t *ja, double *a, index_t len);
+
+/**
+ * @brief	Every conversion comes in two variants: the plain one allocates a new block for the
+ * 			output matrix, while the *_into one reuses the output's block when it is large enough
+ * 			(see reserve_*), which avoids the allocator churn of pipelines that rebuild matrices of
+ * 			the same size. The output of an *_into call must have been allocated before, or reset
+ * 			with reset_matrix_storage().
+ * */
 void 	convert_COO_to_CSR(SparseMatrix *COO, SparseMatrix *CSR);
 
+void 	convert_COO_to_CSR_into(SparseMatrix *COO, SparseMatrix *CSR);
+
+/**
+ * @brief	Converts a COO matrix whose entries are in arbitrary order into CSR format.
+ * 			The entries are sorted by (row, column) with a parallel LSD radix sort, so the
+ * 			columns of each row come out sorted.
+ * @param	sum_duplicates 	: if nonzero, entries with the same (row, column) are summed into one;
+ * 							  otherwise they are all kept, in their original relative order.
+ * */
+void 	convert_unsorted_COO_to_CSR(SparseMatrix *COO, SparseMatrix *CSR, int sum_duplicates);
+
+void 	convert_unsorted_COO_to_CSR_into(SparseMatrix *COO, SparseMatrix *CSR, int sum_duplicates);
+
 void 	convert_CSR_to_COO(SparseMatrix *CSR, SparseMatrix *COO);
 
+void 	convert_CSR_to_COO_into(SparseMatrix *CSR, SparseMatrix *COO);
+
+/**
+ * @brief	Ownership-transferring conversions: the ja and a arrays are the same in COO and CSR
+ * 			format, so the output takes over the storage of the input and only the row array is
+ * 			rebuilt, without copying the values. The row array goes into free space of the storage
+ * 			block when there is some, and the block is grown otherwise. The input is reset; the
+ * 			output may be the input itself, and any storage it held before is not freed.
+ * 			The entries of the COO matrix must be sorted by row. The matrix must own its arrays
+ * 			(a matrix from map_binary_matrix() does not).
+ * */
+void 	convert_COO_to_CSR_move(SparseMatrix *COO, SparseMatrix *CSR);
+
+void 	convert_CSR_to_COO_move(SparseMatrix *CSR, SparseMatrix *COO);
+
 void 	convert_CSR_to_CSC(SparseMatrix *CSR, SparseMatrix *CSC);
 
+void 	convert_CSR_to_CSC_into(SparseMatrix *CSR, SparseMatrix *CSC);
+
 void 	convert_CSC_to_CSR(SparseMatrix *CSC, SparseMatrix *CSR);
 
+void 	convert_CSC_to_CSR_into(SparseMatrix *CSC, SparseMatrix *CSR);
+
 void 	transpose_CSR(const SparseMatrix *CSR, SparseMatrix *transpose);
 
+void 	transpose_CSR_into(const SparseMatrix *CSR, SparseMatrix *transpose);
+
+
+/**
+ * @brief	Multithreaded versions of the conversions above, based on per-thread column
+ * 			histograms and a parallel prefix sum. The output is identical to the serial one,
+ * 			with the indices sorted within every row (or column).
+ * */
+void 	convert_CSR_to_CSC_parallel(SparseMatrix *CSR, SparseMatrix *CSC);
+
+void 	convert_CSC_to_CSR_parallel(SparseMatrix *CSC, SparseMatrix *CSR);
+
+void 	transpose_CSR_parallel(const SparseMatrix *CSR, SparseMatrix *transpose);
+
+void 	convert_CSR_to_CSC_parallel_into(SparseMatrix *CSR, SparseMatrix *CSC);
+
+void 	convert_CSC_to_CSR_parallel_into(SparseMatrix *CSC, SparseMatrix *CSR);
+
+void 	transpose_CSR_parallel_into(const SparseMatrix *CSR, SparseMatrix *transpose);
+
+
+/**
+ * @brief	Transposes a square CSR matrix in its own arrays, with O(nr) extra memory instead of
+ * 			a second copy of the matrix, at the price of a serial O(nnz log nr) permutation.
+ * 			The columns of the transpose are sorted within each row.
+ * @return	0 on success, -1 if the matrix is not square
+ * */
+int 	transpose_CSR_inplace(SparseMatrix *CSR);
+
 
 /**
  * @return 	1 if the sparse matrix in CSR format is numerically symmetric, and 0 otherwise.
+ * 			The columns are assumed to be sorted within each row; rectangular matrices are never symmetric.
  * */
 int 	is_symmetric(SparseMatrix *CSR);
 
+/**
+ * @return 	1 if the sparsity pattern of the CSR matrix is symmetric, whatever the values, and 0 otherwise.
+ * */
+int 	is_structurally_symmetric(SparseMatrix *CSR);
+
+/**
+ * @return 	1 if the CSR matrix is symmetric up to the relative tolerance rtol, and 0 otherwise:
+ * 			the pattern must be symmetric and |a_ij - a_ji| <= rtol * max(|a_ij|, |a_ji|).
+ * */
+int 	is_numerically_symmetric(SparseMatrix *CSR, double rtol);
+
 void 	extract_upper_triangular(SparseMatrix *CSR, SparseMatrix *upper);
 
 void 	extract_lower_triangular(SparseMatrix *CSR, SparseMatrix *lower);
@@ -98,8 +206,6 @@ void 	print_CSR_matrix(SparseMatrix *CSR);
 
 void 	print_CSC_matrix(SparseMatrix *CSR);
 
-void 	write_CSR_matrix_to_file(SparseMatrix *mat);
-
 void 	plot_sparsity_pattern(SparseMatrix *mat);
 
 void 	deallocate_sparse_matrix(SparseMatrix *mat);
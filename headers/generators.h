@@ -0,0 +1,98 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+/**
+ * Synthetic sparse matrices for tests and scaling studies, written directly in CSR format.
+ * Every generator makes two parallel passes over the rows: the first one counts the entries of
+ * each row, so that the matrix is allocated once at its exact size, and the second one writes
+ * them. No intermediate COO copy is made, so the peak memory is the CSR matrix itself plus one
+ * row pointer array. The random generators draw the entries of row i from a random stream
+ * derived from (seed, i): the output only depends on the seed, not on the number of threads.
+ * The columns are sorted within each row. All generators return 0, or -1 on invalid parameters.
+ * */
+
+
+/**
+ * @brief	5-point Laplacian on an nx x ny grid: 4 on the diagonal, -1 for each neighbour.
+ * */
+int 	generate_laplacian_2d(index_t nx, index_t ny, SparseMatrix *CSR);
+
+
+/**
+ * @brief	7-point or 27-point Laplacian on an nx x ny x nz grid: 6 (or 26) on the diagonal,
+ * 			-1 for each neighbour.
+ * */
+int 	generate_laplacian_3d(index_t nx, index_t ny, index_t nz, int points, SparseMatrix *CSR);
+
+
+/**
+ * @brief	Banded n x n matrix with lower and upper bandwidths, fully populated within the band:
+ * 			-1 off the diagonal, and lower + upper + 1 on the diagonal.
+ * */
+int 	generate_banded(index_t n, index_t lower, index_t upper, SparseMatrix *CSR);
+
+
+/**
+ * @brief	Erdos-Renyi random nr x nc matrix: every row draws about nnz_per_row columns uniformly
+ * 			(duplicates are merged), with values uniform in (0, 1].
+ * */
+int 	generate_random_uniform(index_t nr, index_t nc, double nnz_per_row, uint64_t seed, SparseMatrix *CSR);
+
+
+/**
+ * @brief	R-MAT power-law matrix of order 2^scale with about edge_factor * 2^scale entries.
+ * 			Each entry falls recursively in one of the four quadrants with probabilities a, b, c and
+ * 			d = 1 - a - b - c; the skew of the degree distribution grows with a. With independent
+ * 			levels, the row of an entry and its column given the row can be drawn separately, which
+ * 			makes rows independent. Typical (Graph500) parameters: a = 0.57, b = c = 0.19.
+ * */
+int 	generate_rmat(int scale, double edge_factor, double a, double b, double c, uint64_t seed, SparseMatrix *CSR);
+
+
+/**
+ * @brief	Block-structured, FEM-like matrix: bilinear quadrilateral elements on an nx x ny node
+ * 			grid with dof unknowns per node, so that every node couples with its (up to) 9
+ * 			neighbouring nodes through dense dof x dof blocks. The matrix is symmetric and
+ * 			diagonally dominant.
+ * */
+int 	generate_fem_blocks_2d(index_t nx, index_t ny, int dof, SparseMatrix *CSR);
+
+
+#endif
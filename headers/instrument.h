@@ -0,0 +1,187 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include "utilities.h"
+
+/**
+ * Built-in instrumentation of the library entry points, enabled at compile time with
+ * SPARSE_INSTRUMENT (cmake -DSPARSE_INSTRUMENT=ON). When it is disabled, the INSTRUMENT_*
+ * macros expand to nothing, so the kernels carry no overhead, and the query functions
+ * below report zeros.
+ *
+ * Every instrumented call records its wall time, the bytes it moves (an estimate of the
+ * compulsory traffic of its input and output arrays) and the number of nonzero entries it
+ * processes in counters owned by the calling thread, so that recording takes no lock.
+ * The counters of all the threads are summed when they are queried.
+ * */
+
+
+/**
+ * X-macro list of the instrumented operations: X(identifier, name).
+ * The plain conversions share the operation of their _into variant.
+ * */
+#define INSTRUMENTED_OPERATIONS(X) 										\
+	X(OP_READ_MATRIX_MARKET, 			"read_matrix_market_CSR") 			\
+	X(OP_WRITE_BINARY, 					"write_binary_matrix") 				\
+	X(OP_MAP_BINARY, 					"map_binary_matrix") 				\
+	X(OP_COO_TO_CSR, 					"convert_COO_to_CSR") 				\
+	X(OP_UNSORTED_COO_TO_CSR, 			"convert_unsorted_COO_to_CSR") 		\
+	X(OP_CSR_TO_COO, 					"convert_CSR_to_COO") 				\
+	X(OP_COO_TO_CSR_MOVE, 				"convert_COO_to_CSR_move") 			\
+	X(OP_CSR_TO_COO_MOVE, 				"convert_CSR_to_COO_move") 			\
+	X(OP_CSR_TO_CSC, 					"convert_CSR_to_CSC") 				\
+	X(OP_CSC_TO_CSR, 					"convert_CSC_to_CSR") 				\
+	X(OP_TRANSPOSE_CSR, 				"transpose_CSR") 					\
+	X(OP_CSR_TO_CSC_PARALLEL, 			"convert_CSR_to_CSC_parallel") 		\
+	X(OP_CSC_TO_CSR_PARALLEL, 			"convert_CSC_to_CSR_parallel") 		\
+	X(OP_TRANSPOSE_CSR_PARALLEL, 		"transpose_CSR_parallel") 			\
+	X(OP_TRANSPOSE_CSR_INPLACE, 		"transpose_CSR_inplace") 			\
+	X(OP_CHECK_SYMMETRY, 				"check_symmetry") 					\
+	X(OP_EXTRACT_TRIANGULAR, 			"extract_triangular") 				\
+	X(OP_SPMV_CSR, 						"spmv_CSR") 						\
+	X(OP_SPMV_CSR_MERGE_PATH, 			"spmv_CSR_merge_path") 				\
+	X(OP_CSR_TO_SELL, 					"convert_CSR_to_SELL") 				\
+	X(OP_SPMV_SELL, 					"spmv_SELL") 						\
+	X(OP_CSR_TO_BSR, 					"convert_CSR_to_BSR") 				\
+	X(OP_BSR_TO_CSR, 					"convert_BSR_to_CSR") 				\
+	X(OP_SPMV_BSR, 						"spmv_BSR") 						\
+	X(OP_SPMV_SYMMETRIC, 				"spmv_symmetric") 					\
+	X(OP_SPGEMM_SYMBOLIC, 				"spgemm_symbolic") 					\
+	X(OP_SPGEMM_NUMERIC, 				"spgemm_numeric") 					\
+	X(OP_SPTRSV_ANALYSIS, 				"sptrsv_analysis") 					\
+	X(OP_SPTRSV_SOLVE, 					"sptrsv_solve") 					\
+	X(OP_RCM_ORDERING, 					"compute_RCM_ordering") 			\
+	X(OP_PERMUTE_CSR, 					"permute_CSR") 						\
+	X(OP_STREAM_SPMV, 					"stream_spmv") 						\
+	X(OP_STREAM_TRIANGULAR, 			"stream_extract_triangular") 		\
+	X(OP_STREAM_TRANSPOSE, 				"stream_transpose_to_file") 		\
+	X(OP_DENSITY_GRID, 					"compute_density_grid") 			\
+	X(OP_SPMM_CSR, 						"spmm_CSR") 						\
+	X(OP_CSR_TO_DELTA, 					"convert_CSR_to_DELTA") 			\
+	X(OP_SPMV_DELTA, 					"spmv_DELTA") 						\
+	X(OP_CG_SOLVE, 						"cg_solve")
+
+#define INSTRUMENT_ENUM_ENTRY(id, name) 	id,
+
+typedef enum {
+	INSTRUMENTED_OPERATIONS(INSTRUMENT_ENUM_ENTRY)
+	OP_COUNT
+} InstrumentedOperation;
+
+
+//Bytes of a CSR (n = nr) or CSC (n = nc) matrix, of a COO matrix, and of the x and y vectors of y = A*x
+#define COMPRESSED_BYTES(n, nnz) 	(((uint64_t)(n) + 1) * INDEX_SIZE + (uint64_t)(nnz) * (INDEX_SIZE + DOUBLE_SIZE))
+#define COO_BYTES(nnz) 				((uint64_t)(nnz) * (2 * INDEX_SIZE + DOUBLE_SIZE))
+#define VECTOR_BYTES(nr, nc) 		(((uint64_t)(nr) + (uint64_t)(nc)) * DOUBLE_SIZE)
+
+
+#ifdef SPARSE_INSTRUMENT
+#define INSTRUMENT_BEGIN() 						double instrument_start_ = instrument_clock()
+#define INSTRUMENT_END(op, bytes, nnz) 			instrument_record((op), instrument_clock() - instrument_start_, (uint64_t)(bytes), (uint64_t)(nnz))
+#define INSTRUMENT_ALLOCATION(size) 			instrument_allocation(size)
+#define INSTRUMENT_RELEASE(size) 				instrument_release(size)
+#else
+#define INSTRUMENT_BEGIN() 						((void)0)
+#define INSTRUMENT_END(op, bytes, nnz) 			((void)0)
+#define INSTRUMENT_ALLOCATION(size) 			((void)0)
+#define INSTRUMENT_RELEASE(size) 				((void)0)
+#endif
+
+
+//Aggregated counters of one operation
+typedef struct {
+	const char 	*name;
+	uint64_t 	calls;
+	double 		seconds;		//total wall time
+	double 		max_seconds;	//longest call
+	uint64_t 	bytes;
+	uint64_t 	nnz;
+} OperationStats;
+
+
+//Matrix storage allocated through the reserve_*/allocate_* functions
+typedef struct {
+	uint64_t 	allocations;		//number of blocks allocated
+	uint64_t 	allocated_bytes;	//total size of the blocks allocated
+	size_t 		current_bytes;		//size of the blocks still alive
+	size_t 		peak_bytes;			//high-water mark of current_bytes
+} MemoryStats;
+
+
+/**
+ * @return	1 if the library was compiled with SPARSE_INSTRUMENT, 0 otherwise.
+ * */
+int 	instrument_enabled(void);
+
+
+/**
+ * @brief	Sums the counters of operation op over all the threads.
+ * */
+void 	instrument_get_operation(InstrumentedOperation op, OperationStats *stats);
+
+
+void 	instrument_get_memory(MemoryStats *stats);
+
+
+/**
+ * @brief	Clears all the counters; the memory high-water mark restarts from the current usage.
+ * 			Neither the query functions nor this one synchronize with the recording threads,
+ * 			so they should be called while no instrumented operation is running.
+ * */
+void 	instrument_reset(void);
+
+
+/**
+ * @brief	Writes the operations called at least once and the memory counters,
+ * 			as an aligned text table or as a JSON object.
+ * */
+void 	instrument_dump(FILE *out);
+
+
+void 	instrument_dump_json(FILE *out);
+
+
+//Recording functions behind the INSTRUMENT_* macros
+double 	instrument_clock(void);
+
+void 	instrument_record(InstrumentedOperation op, double seconds, uint64_t bytes, uint64_t nnz);
+
+void 	instrument_allocation(size_t size);
+
+void 	instrument_release(size_t size);
+
+
+#endif
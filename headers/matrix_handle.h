@@ -0,0 +1,142 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MATRIX_HANDLE_H
+#define MATRIX_HANDLE_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+//Forms derived from the canonical CSR matrix of a handle
+typedef enum {
+	VIEW_CSC,			//the same matrix in CSC format
+	VIEW_TRANSPOSE,		//the transpose in CSR format
+	VIEW_COO,			//the same matrix in (row-major) COO format
+	VIEW_LOWER,			//lower triangle, diagonal included, in CSR format
+	VIEW_UPPER,			//upper triangle, diagonal included, in CSR format
+	VIEW_COUNT
+} MatrixView;
+
+
+typedef struct {
+	SparseMatrix 	mat;
+	uint64_t 		version;	//version of the CSR matrix the form was built from, 0 if not built
+	uint64_t 		last_use;	//value of the handle clock at the last request, for LRU eviction
+} CachedView;
+
+
+//Cached result of a symmetry check
+typedef struct {
+	int 		value;
+	uint64_t 	version;		//version it was computed at, 0 if never computed
+} CachedFlag;
+
+
+/**
+ * Handle owning a CSR matrix and the forms derived from it, which are built on first request
+ * and cached, so that every conversion runs at most once per version of the matrix.
+ *
+ * The values and the pattern of the CSR matrix have separate version counters, bumped by
+ * mark_values_changed() and mark_pattern_changed() after the caller modifies the matrix in place.
+ * A derived form built at an older version is rebuilt on its next request, reusing its storage
+ * block. The structural symmetry flag only depends on the pattern, so it survives value changes.
+ *
+ * The derived forms are limited to a memory budget: building a form that would exceed it
+ * first frees the least recently requested ones. A form larger than the whole budget is still
+ * built, and is the first one freed on the next request.
+ * */
+typedef struct {
+	SparseMatrix 	CSR;					//canonical matrix, columns sorted within each row
+	uint64_t 		version;				//bumped on every change of the values or of the pattern
+	uint64_t 		pattern_version;		//bumped on every change of the pattern
+	uint64_t 		clock;					//request counter
+	size_t 			budget;					//bytes allowed for the derived forms, 0 for no limit
+	size_t 			cached_bytes;			//bytes held by the derived forms
+	CachedView 		views[VIEW_COUNT];
+	CachedFlag 		symmetric;				//numerical symmetry, exact
+	CachedFlag 		structurally_symmetric;
+} MatrixHandle;
+
+
+/**
+ * @brief	Initializes a handle that takes ownership of the CSR matrix: CSR is reset, and the
+ * 			matrix is then freed by deallocate_matrix_handle().
+ * @param	budget 	: bytes allowed for the derived forms, 0 for no limit
+ * */
+void 	init_matrix_handle(MatrixHandle *handle, SparseMatrix *CSR, size_t budget);
+
+
+/**
+ * @return	the derived form, built if absent or older than the CSR matrix.
+ * 			The pointer stays valid until the next request, budget change or modification
+ * 			of the handle, any of which may free or rebuild the form.
+ * */
+const SparseMatrix 	*get_matrix_view(MatrixHandle *handle, MatrixView view);
+
+
+/**
+ * @brief	Symmetry checks of the canonical matrix (see is_symmetric and
+ * 			is_structurally_symmetric), cached until the matrix changes.
+ * */
+int 	handle_is_symmetric(MatrixHandle *handle);
+
+int 	handle_is_structurally_symmetric(MatrixHandle *handle);
+
+
+/**
+ * @brief	Must be called after the values (resp. the pattern, and possibly the dimensions) of
+ * 			handle->CSR have been modified, so that the derived forms and flags are rebuilt.
+ * */
+void 	mark_values_changed(MatrixHandle *handle);
+
+void 	mark_pattern_changed(MatrixHandle *handle);
+
+
+/**
+ * @brief	Changes the memory budget of the derived forms, freeing the least recently
+ * 			requested ones until the new budget is met.
+ * */
+void 	set_handle_memory_budget(MatrixHandle *handle, size_t budget);
+
+
+/**
+ * @brief	Frees the derived forms, keeping the canonical matrix.
+ * */
+void 	clear_matrix_views(MatrixHandle *handle);
+
+
+void 	deallocate_matrix_handle(MatrixHandle *handle);
+
+
+#endif
@@ -0,0 +1,166 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include <stdint.h>
+
+#include "formats.h"
+#include "parallel.h"
+
+//Binary container: file signature, version, and alignment of the data sections
+#define BINARY_MAGIC 			"SPMATBIN"
+#define BINARY_VERSION 			2
+#define BINARY_ALIGNMENT 		64
+#define BINARY_BYTE_ORDER 		0x01020304u
+
+
+//Storage format of a SparseMatrix; it determines the length of the ia and ja arrays
+typedef enum {
+	FORMAT_COO = 1,
+	FORMAT_CSR = 2,
+	FORMAT_CSC = 3
+} SparseFormat;
+
+
+/**
+ * Header of the binary container. It is followed by the ia, ja and a sections, each one
+ * starting at a multiple of BINARY_ALIGNMENT bytes from the beginning of the file.
+ * Every section has its own checksum, so that it can be verified (or computed while
+ * writing) independently of the others.
+ * */
+typedef struct {
+	char 		magic[8];			//BINARY_MAGIC, not null-terminated
+	uint32_t 	version;
+	uint32_t 	byte_order;			//BINARY_BYTE_ORDER as written by the producer
+	uint32_t 	format;				//SparseFormat
+	uint32_t 	index_size;			//size in bytes of one entry of ia and ja, i.e. sizeof(index_t)
+	uint32_t 	value_size;			//size in bytes of one entry of a
+	uint32_t 	reserved;
+	uint64_t 	nr;
+	uint64_t 	nc;
+	uint64_t 	nnz;
+	uint64_t 	ia_offset;			//offsets in bytes from the beginning of the file
+	uint64_t 	ja_offset;
+	uint64_t 	a_offset;
+	uint64_t 	ia_length;			//number of entries of ia
+	uint64_t 	ja_length;			//number of entries of ja
+	uint64_t 	ia_checksum;
+	uint64_t 	ja_checksum;
+	uint64_t 	a_checksum;
+	uint64_t 	padding[1];			//pads the header to 128 bytes
+} BinaryHeader;
+
+
+/**
+ * A sparse matrix whose arrays point directly into a read-only memory-mapped file.
+ * The arrays of mat must not be modified or freed; release them with unmap_binary_matrix().
+ * */
+typedef struct {
+	SparseMatrix 	mat;
+	SparseFormat 	format;
+	void 			*base;			//start of the mapping
+	size_t 			size;			//length of the mapping
+} MappedMatrix;
+
+
+/**
+ * @brief	Reads a Matrix Market (.mtx) coordinate file straight into CSR format.
+ * 			The file is memory-mapped and split at line boundaries among the threads,
+ * 			which parse it in two passes: the first one counts the entries of each row,
+ * 			the second one scatters them into the preallocated CSR arrays.
+ * 			No intermediate COO copy is built, and the columns of each row are sorted.
+ *
+ * 			Supported qualifiers: real/integer/pattern values and
+ * 			general/symmetric/skew-symmetric storage. Pattern entries are set to 1,
+ * 			and the missing triangle of (skew-)symmetric matrices is filled in.
+ *
+ * @param	filename 	: path to the .mtx file
+ * @param	CSR 		: output matrix, allocated by this function
+ * @return	0 on success, -1 if the file cannot be read or is not supported.
+ * */
+int 	read_matrix_market_CSR(const char *filename, SparseMatrix *CSR);
+
+
+/**
+ * @brief	Checksum of a data section: 64-bit FNV-1a over 32-bit words.
+ * 			It can be computed incrementally: pass the previous result as seed,
+ * 			and BINARY_CHECKSUM_SEED for the first block. len must be a multiple of 4.
+ * */
+#define BINARY_CHECKSUM_SEED 	0xcbf29ce484222325ULL
+
+uint64_t 	binary_checksum(uint64_t seed, const void *data, size_t len);
+
+
+/**
+ * @brief	Fills in a header for sections of the given lengths, laid out one after the other
+ * 			from the end of the header; the checksums are left to the caller.
+ * */
+void 	init_binary_header(BinaryHeader *header, SparseFormat format, uint64_t nr, uint64_t nc, uint64_t nnz,
+						   uint64_t ia_length, uint64_t ja_length);
+
+
+/**
+ * @brief	Checks that the header was written by a compatible producer, that its dimensions
+ * 			fit in index_t, that the section lengths are those implied by the format
+ * 			(nr + 1 or nnz for ia, nc + 1 or nnz for ja), and that the sections lie inside
+ * 			a file of the given size.
+ * @return	0 if the header is valid, -1 otherwise.
+ * */
+int 	validate_binary_header(const BinaryHeader *header, size_t size);
+
+
+/**
+ * @brief	Writes a sparse matrix to a binary container file.
+ * @param	format 	: storage format of mat, which determines the length of ia and ja
+ * @return	0 on success, -1 on an I/O error.
+ * */
+int 	write_binary_matrix(const char *filename, const SparseMatrix *mat, SparseFormat format);
+
+
+/**
+ * @brief	Opens a binary container file without copying or parsing the data:
+ * 			the arrays of map->mat point into the shared, read-only file mapping,
+ * 			so the page cache is shared by every process that maps the same file.
+ * @param	verify 	: if nonzero, the section checksums are verified and the structure is checked
+ * 					  (pointers from 0 to nnz, nondecreasing, indices in range), which reads the whole file
+ * @return	0 on success, -1 if the file cannot be mapped or is not a valid container.
+ * */
+int 	map_binary_matrix(const char *filename, MappedMatrix *map, int verify);
+
+
+void 	unmap_binary_matrix(MappedMatrix *map);
+
+
+#endif
@@ -0,0 +1,117 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "utilities.h"
+
+/**
+ * Below this number of nonzero entries, the kernels run on a single thread,
+ * since the cost of waking up the thread team outweighs the work itself.*/
+#define PARALLEL_NNZ_THRESHOLD 	20000
+
+//First index of block part out of nparts equal blocks of [0, n), without overflowing index_t
+#define BLOCK_BEGIN(n, part, nparts) 	((index_t)((int64_t)(n) * (part) / (nparts)))
+
+
+/**
+ * @brief	Thin wrappers around the OpenMP runtime, so that the library also builds
+ * 			(and runs serially) when the compiler does not support OpenMP.
+ * */
+static inline int get_max_threads(void) {
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+static inline int get_num_threads(void) {
+#ifdef _OPENMP
+	return omp_get_num_threads();
+#else
+	return 1;
+#endif
+}
+
+static inline int get_thread_num(void) {
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+static inline void set_num_threads(int nthreads) {
+#ifdef _OPENMP
+	omp_set_num_threads(nthreads);
+#else
+	(void)nthreads;
+#endif
+}
+
+
+/**
+ * @brief	Splits the rows of a CSR matrix into nparts contiguous blocks holding
+ * 			(approximately) the same number of nonzero entries.
+ * @param	ia 		: row pointer array of length (nr + 1)
+ * @param	nr 		: number of rows
+ * @param	part 	: index of the block, in [0, nparts]
+ * @param	nparts 	: number of blocks
+ * @return	the first row of block part; part = nparts yields nr.
+ * */
+index_t 	nnz_balanced_row_split(const index_t *ia, index_t nr, int part, int nparts);
+
+
+/**
+ * @brief	Merge-path search: finds the coordinate (row, nz) at which the given diagonal
+ * 			crosses the merge of the row end offsets ia[1..nr] with the nonzero indices.
+ * 			Splitting rows and nonzero entries together in this way balances the work
+ * 			even when a few rows hold most of the nonzero entries.
+ * */
+void 	merge_path_search(const index_t *ia, index_t nr, index_t nnz, int64_t diagonal, index_t *row, index_t *nz);
+
+
+/**
+ * @brief	Parallel in-place exclusive prefix sum: arr[i] becomes arr[0] + ... + arr[i - 1].
+ * @return	the sum of all the n entries.
+ * */
+index_t 	parallel_exclusive_scan(index_t *arr, index_t n);
+
+
+#endif
@@ -0,0 +1,83 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+/**
+ * Sparsity pattern images. The nonzero entries are binned into a density grid in one parallel
+ * pass over the CSR arrays, so the rendering time beyond that pass only depends on the image
+ * size. Every cell is shaded by log(1 + count) / log(1 + max_count): empty cells are white and
+ * the densest ones black. The image is written directly as PNG or binary PGM.
+ * */
+typedef struct {
+	int 		width;				//cells along the columns
+	int 		height;				//cells along the rows
+	uint64_t 	*count;				//nonzero entries of every cell, row-major
+	uint64_t 	max_count;			//largest count of a cell
+} DensityGrid;
+
+
+/**
+ * @brief	Bins the nonzero entries of a CSR matrix into a width x height grid:
+ * 			entry (i, j) falls into cell (i * height / nr, j * width / nc), rounded down.
+ * @return	0 on success, -1 if the matrix or the grid is empty.
+ * */
+int 	compute_density_grid(const SparseMatrix *CSR, int width, int height, DensityGrid *grid);
+
+
+/**
+ * @brief	Writes the grid as a width x height grayscale image, scaled with nearest-neighbour
+ * 			sampling. The format is binary PGM if filename ends in ".pgm", and PNG otherwise.
+ * @return	0 on success, -1 on an I/O error.
+ * */
+int 	write_density_image(const DensityGrid *grid, int width, int height, const char *filename);
+
+
+/**
+ * @brief	Renders the sparsity pattern of a CSR matrix into an image whose longer side is
+ * 			resolution pixels, keeping the aspect ratio of the matrix. Matrices smaller than
+ * 			the image get one cell per entry, scaled up.
+ * @return	0 on success, -1 on an empty matrix or an I/O error.
+ * */
+int 	render_sparsity_pattern(const SparseMatrix *CSR, int resolution, const char *filename);
+
+
+void 	deallocate_density_grid(DensityGrid *grid);
+
+
+#endif
@@ -0,0 +1,94 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef REORDER_H
+#define REORDER_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+/**
+ * Permutations are arrays perm of length n such that perm[new] = old: row (or column) new of
+ * the permuted matrix is row (or column) perm[new] of the original one.
+ * The orderings are computed on the pattern of A + A^T, so nonsymmetric matrices are
+ * symmetrized first; the matrix must be square. Diagonal entries are ignored.
+ * */
+
+
+/**
+ * @brief	Reverse Cuthill-McKee ordering, which reduces the bandwidth and the profile so that
+ * 			the x entries read by each row of an SpMV are close to each other in memory.
+ * 			Every connected component is ordered by a breadth-first search started from a
+ * 			pseudo-peripheral node, visiting the neighbours by increasing degree.
+ * @return	0 on success, -1 if the matrix is not square
+ * */
+int 	compute_RCM_ordering(const SparseMatrix *CSR, index_t *perm);
+
+
+/**
+ * @brief	Orders the rows by increasing degree, ties kept in the original order. This is much
+ * 			cheaper than RCM, and groups rows of similar length (e.g. for SELL-C-sigma slices).
+ * @return	0 on success, -1 if the matrix is not square
+ * */
+int 	compute_degree_ordering(const SparseMatrix *CSR, index_t *perm);
+
+
+/**
+ * @brief	Sets inverse[perm[i]] = i for i = 0, ..., n - 1.
+ * */
+void 	invert_permutation(const index_t *perm, index_t n, index_t *inverse);
+
+
+/**
+ * @brief	Applies a row permutation P and a column permutation Q: B(i, j) = A(P[i], Q[j]).
+ * 			A symmetric permutation is P = Q = perm. Either permutation may be NULL for the identity.
+ * 			The columns of B are sorted within each row. The rows are processed in parallel.
+ * */
+void 	permute_CSR(const index_t *P, const SparseMatrix *A, const index_t *Q, SparseMatrix *B);
+
+
+/**
+ * @return	the bandwidth of the CSR matrix, max |i - j| over its entries.
+ * */
+index_t 	matrix_bandwidth(const SparseMatrix *CSR);
+
+
+/**
+ * @return	the profile (envelope size) of the CSR matrix: the sum over the rows of the distance
+ * 			between the diagonal and the leftmost entry of the row, if it lies before the diagonal.
+ * */
+int64_t 	matrix_profile(const SparseMatrix *CSR);
+
+
+#endif
@@ -0,0 +1,111 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SELL_H
+#define SELL_H
+
+#include "formats.h"
+#include "parallel.h"
+
+//Default slice height and sorting window of the SELL-C-sigma format
+#define SELL_DEFAULT_C 			8
+#define SELL_DEFAULT_SIGMA 		256
+
+
+/**
+ * Sliced ELLPACK (SELL-C-sigma) storage.
+ * The rows are grouped into slices of C consecutive rows, and every slice is padded to the
+ * length of its longest row. The entries of a slice are stored column by column, so that C
+ * consecutive values belong to C different rows and can be processed by one SIMD instruction.
+ * To limit padding, the rows are sorted by decreasing length within windows of sigma rows;
+ * perm keeps track of the original row of each stored row.
+ * */
+typedef struct {
+	index_t 	nr;				//number of rows
+	index_t 	nc;				//number of columns
+	index_t 	nnz;			//number of nonzero entries, padding excluded
+	int 		C;				//slice height
+	int 		sigma;			//sorting window
+	index_t 	nslices;		//number of slices, i.e. ceil(nr / C)
+	index_t 	*slice_ptr;		//offset of the first entry of each slice in ja and a, length (nslices + 1)
+	index_t 	*perm;			//original row of each stored row, -1 for padding rows, length (nslices * C)
+	index_t 	*ja;			//column indices, stored column-major within each slice
+	double 		*a;				//values, stored column-major within each slice
+} SellMatrix;
+
+
+typedef enum {
+	SELL_KERNEL_AUTO,		//chosen at runtime from the CPU features
+	SELL_KERNEL_SCALAR,
+	SELL_KERNEL_AVX2,		//requires C to be a multiple of 4
+	SELL_KERNEL_AVX512		//requires C to be a multiple of 8
+} SellKernel;
+
+
+/**
+ * @brief	Converts a CSR matrix into the SELL-C-sigma format.
+ * @param	C 		: slice height; use a multiple of 8 to enable all vectorized kernels
+ * @param	sigma 	: sorting window; 1 disables sorting, nr sorts all rows globally
+ * */
+void 	convert_CSR_to_SELL(const SparseMatrix *CSR, SellMatrix *SELL, int C, int sigma);
+
+
+/**
+ * @return	the ratio between stored entries (padding included) and nonzero entries.
+ * */
+double 	SELL_padding_ratio(const SellMatrix *SELL);
+
+
+/**
+ * @return	the fastest kernel supported by both the CPU and the slice height of SELL.
+ * */
+SellKernel 	select_SELL_kernel(const SellMatrix *SELL);
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x, with the kernel selected by CPUID.
+ * */
+void 	spmv_SELL(const SellMatrix *SELL, const double *x, double *y);
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x with an explicitly chosen kernel.
+ * 			An unsupported kernel falls back to the scalar one.
+ * */
+void 	spmv_SELL_kernel(const SellMatrix *SELL, const double *x, double *y, SellKernel kernel);
+
+
+void 	deallocate_SELL_matrix(SellMatrix *SELL);
+
+
+#endif
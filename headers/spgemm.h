@@ -0,0 +1,74 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPGEMM_H
+#define SPGEMM_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+//A row of C uses a dense accumulator when its size bound exceeds nc / SPGEMM_DENSE_RATIO
+#define SPGEMM_DENSE_RATIO 	16
+
+
+/**
+ * @brief	Symbolic phase of the sparse matrix-matrix product C = A*B, all in CSR format.
+ * 			The exact number of entries of every row of C is counted first, so that C is
+ * 			allocated once, then the column indices of C are computed and sorted within each row.
+ * 			The values of C are left uninitialized until spgemm_numeric() is called.
+ * @return	0 on success, -1 if the dimensions do not match or C has too many entries for index_t
+ * */
+int 	spgemm_symbolic(const SparseMatrix *A, const SparseMatrix *B, SparseMatrix *C);
+
+
+/**
+ * @brief	Numeric phase of C = A*B: computes the values of C, whose pattern must come from
+ * 			spgemm_symbolic() with matrices of the same sparsity patterns as A and B.
+ * 			It can be called again whenever only the values of A or B change.
+ * @return	0 on success, -1 if the dimensions do not match
+ * */
+int 	spgemm_numeric(const SparseMatrix *A, const SparseMatrix *B, SparseMatrix *C);
+
+
+/**
+ * @brief	Sparse matrix-matrix product C = A*B: symbolic phase followed by the numeric one.
+ * 			Both phases are row-parallel (Gustavson's algorithm); each thread accumulates the
+ * 			rows of C in a private hash table, or in a dense array for rows that are dense
+ * 			enough. A Galerkin product R*A*P is two calls.
+ * @return	0 on success, -1 on error
+ * */
+int 	spgemm(const SparseMatrix *A, const SparseMatrix *B, SparseMatrix *C);
+
+
+#endif
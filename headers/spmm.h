@@ -0,0 +1,65 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPMM_H
+#define SPMM_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+//Storage order of a dense block of vectors
+typedef enum {
+	LAYOUT_ROW_MAJOR,		//entry (j, v) at X[j * ldx + v]: the k values of a row are contiguous
+	LAYOUT_COL_MAJOR		//entry (j, v) at X[v * ldx + j]: every vector is contiguous
+} DenseLayout;
+
+
+/**
+ * @brief	Sparse matrix times dense block product Y = A*X, for a block of k vectors.
+ * 			Every nonzero entry of A is read once per tile of up to 16 vectors, instead of
+ * 			once per vector, i.e. ceil(k / 16) times: the vectors are processed in tiles of
+ * 			16, then one last tile of the remaining ones, by kernels specialized at compile
+ * 			time that keep the sums of a row in registers and vectorize across the vectors.
+ * 			The rows are distributed among the threads as in spmv_CSR. The row-major layout
+ * 			is the faster one, since the k values multiplied by an entry are contiguous.
+ * @param	CSR 	: sparse matrix in CSR format
+ * @param	layout 	: storage order of both X and Y
+ * @param	k 		: number of vectors
+ * @param	X 		: input block, nc x k, with leading dimension ldx
+ * @param	Y 		: output block, nr x k, with leading dimension ldy, overwritten
+ * */
+void 	spmm_CSR(const SparseMatrix *CSR, DenseLayout layout, index_t k, const double *X, index_t ldx, double *Y, index_t ldy);
+
+
+#endif
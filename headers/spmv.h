@@ -0,0 +1,68 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPMV_H
+#define SPMV_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x for a matrix A stored in CSR format.
+ * 			The rows are distributed among the threads so that each thread processes
+ * 			the same number of nonzero entries, rather than the same number of rows.
+ * @param	CSR : sparse matrix in CSR format
+ * @param	x 	: input vector of length nc
+ * @param	y 	: output vector of length nr, overwritten
+ * */
+void 	spmv_CSR(const SparseMatrix *CSR, const double *x, double *y);
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x based on a merge-path decomposition.
+ * 			Each thread receives the same share of (rows + nonzero entries), so that a
+ * 			single very long row is split across several threads.
+ * 			This variant is meant for highly skewed (e.g. power-law) matrices.
+ * */
+void 	spmv_CSR_merge_path(const SparseMatrix *CSR, const double *x, double *y);
+
+
+/**
+ * @brief	In-place sparse matrix-vector product y = alpha*A*x + beta*y.
+ * 			No memory is allocated. If beta is zero, y is not read, so it may be uninitialized.
+ * */
+void 	spmv_CSR_axpby(double alpha, const SparseMatrix *CSR, const double *x, double beta, double *y);
+
+
+#endif
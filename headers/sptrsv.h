@@ -0,0 +1,89 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPTRSV_H
+#define SPTRSV_H
+
+#include "formats.h"
+#include "parallel.h"
+
+//Below this average number of rows per level, the solve runs serially in row order
+#define SPTRSV_MIN_LEVEL_WIDTH 	64
+
+
+typedef enum {
+	TRIANGLE_LOWER,
+	TRIANGLE_UPPER
+} TriangleType;
+
+
+/**
+ * Level schedule of a triangular CSR matrix, as computed by the analysis phase.
+ * Row i belongs to level 0 if it depends on no other row, and otherwise to the level
+ * following the highest level among the rows it depends on. The rows of a level are
+ * independent, so they are solved in parallel, one level after the other.
+ * The schedule only depends on the sparsity pattern and can be reused for any values.
+ * */
+typedef struct {
+	index_t 		n;				//number of rows
+	TriangleType 	uplo;			//lower (forward substitution) or upper (backward substitution)
+	int 			unit_diagonal;	//if nonzero, the diagonal is taken as 1 and any stored diagonal is ignored
+	index_t 		nlevels;		//number of levels
+	index_t 		*level_ptr;		//offset of the first row of each level in level_rows, length (nlevels + 1)
+	index_t 		*level_rows;	//rows sorted by level, in increasing order within a level, length n
+	index_t 		*diag;			//position of the diagonal entry of each row in ja and a, -1 if absent
+} TriangularSchedule;
+
+
+/**
+ * @brief	Analysis phase of the triangular solve: builds the level schedule of a square lower
+ * 			or upper triangular CSR matrix, e.g. from extract_lower_triangular().
+ * 			The columns are assumed to be sorted within each row.
+ * @return	0 on success, -1 if the matrix is not square, has an entry on the wrong side of the
+ * 			diagonal or, unless unit_diagonal is set, misses a diagonal entry
+ * */
+int 	sptrsv_analysis(const SparseMatrix *CSR, TriangleType uplo, int unit_diagonal, TriangularSchedule *schedule);
+
+
+/**
+ * @brief	Solves T*x = b by forward (lower) or backward (upper) substitution, where the
+ * 			schedule was built from T or from a matrix with the same pattern.
+ * 			x and b may be the same array.
+ * */
+void 	sptrsv_solve(const SparseMatrix *CSR, const TriangularSchedule *schedule, const double *b, double *x);
+
+
+void 	deallocate_triangular_schedule(TriangularSchedule *schedule);
+
+
+#endif
@@ -0,0 +1,130 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "formats.h"
+#include "parallel.h"
+#include "matrix_io.h"
+#include "sptrsv.h"
+
+
+/**
+ * Out-of-core CSR matrix, for matrices larger than memory: a binary container file in CSR
+ * format (see write_binary_matrix) processed as a sequence of row panels read from disk.
+ * Only the row pointers (nr + 1 entries) stay resident.
+ *
+ * Half of the memory budget holds two panel buffers: while a kernel computes on one panel,
+ * the next one is read into the other buffer with asynchronous (POSIX AIO) reads. The other
+ * half is left to the buffers of the operations themselves, e.g. the buckets of the transpose.
+ * The budget does not cover the row pointers, nor the vectors passed by the caller.
+ * */
+typedef struct {
+	int 			fd;
+	BinaryHeader 	header;
+	index_t 		nr;					//number of rows
+	index_t 		nc;					//number of columns
+	index_t 		nnz;				//number of nonzero entries
+	index_t 		*ia;				//row pointers, resident
+	size_t 			budget;				//memory budget in bytes
+	index_t 		npanels;			//number of row panels
+	index_t 		*panel_ptr;			//first row of every panel, length (npanels + 1)
+	index_t 		max_panel_rows;
+	index_t 		max_panel_nnz;
+} StreamedMatrix;
+
+
+/**
+ * @brief	Function applied to every row panel, in row order.
+ * @param	panel 		: rows [row_begin, row_begin + panel->nr) of the matrix in CSR format, with
+ * 						  row pointers starting at 0 and global column indices. Its arrays are
+ * 						  only valid during the call. a is NULL when the values were not requested.
+ * @param	arg 		: pointer passed through by stream_row_panels()
+ * */
+typedef void (*PanelKernel)(const SparseMatrix *panel, index_t row_begin, void *arg);
+
+
+/**
+ * @brief	Opens a CSR binary container for streaming and splits its rows into panels fitting
+ * 			the memory budget.
+ * 			The header is validated, and the row pointers are checked against their checksum
+ * 			and for running from 0 to nnz without decreasing.
+ * @return	0 on success, -1 if the file is not a valid CSR container or if a single row does
+ * 			not fit in a panel buffer.
+ * */
+int 	open_streamed_matrix(const char *filename, size_t budget, StreamedMatrix *S);
+
+
+/**
+ * @brief	Reads the matrix panel by panel, prefetching the next panel while kernel runs on
+ * 			the current one.
+ * 			The column indices of every panel are checked to lie in [0, nc) before kernel sees them.
+ * @param	need_values 	: if zero, only the column indices are read
+ * @return	0 on success, -1 on a read error or an out-of-range column index.
+ * */
+int 	stream_row_panels(StreamedMatrix *S, int need_values, PanelKernel kernel, void *arg);
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x, where x (nc entries) and y (nr entries) are resident.
+ * @return	0 on success, -1 on a read error.
+ * */
+int 	stream_spmv(StreamedMatrix *S, const double *x, double *y);
+
+
+/**
+ * @brief	Writes the lower or upper triangle, diagonal included, of the matrix to a CSR binary
+ * 			container, in a single pass. The triangle's sections are placed as if it kept all
+ * 			the entries, so the file may contain a hole between its column and value sections.
+ * @return	0 on success, -1 on an I/O error.
+ * */
+int 	stream_extract_triangular(StreamedMatrix *S, TriangleType uplo, const char *filename);
+
+
+/**
+ * @brief	External-memory CSR to CSC conversion, written to a CSC binary container.
+ * 			A first pass counts the entries of every column, and the columns are grouped into
+ * 			buckets of consecutive columns whose entries fit in the memory budget. A second pass
+ * 			appends every entry to its bucket in a scratch file, through small write buffers.
+ * 			Each bucket is then read back, sorted by column in memory and written to its final
+ * 			place. The rows come out sorted within every column.
+ * @return	0 on success, -1 on an I/O error or if a single column does not fit in the budget.
+ * */
+int 	stream_transpose_to_file(StreamedMatrix *S, const char *filename);
+
+
+void 	close_streamed_matrix(StreamedMatrix *S);
+
+
+#endif
@@ -0,0 +1,74 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SYMMETRIC_H
+#define SYMMETRIC_H
+
+#include "formats.h"
+#include "parallel.h"
+
+
+/**
+ * Symmetric matrix stored as its upper triangle, diagonal included, in CSR format.
+ * Every off-diagonal entry a_ij = a_ji is stored once, which halves the memory traffic of the
+ * (memory-bound) matrix-vector product compared with the full CSR matrix.
+ * */
+typedef struct {
+	SparseMatrix 	upper;			//upper triangle in CSR format, columns sorted within each row
+} SymmetricMatrix;
+
+
+/**
+ * @brief	Converts a symmetric CSR matrix into symmetric storage.
+ * @param	rtol 	: relative tolerance of the symmetry check (see is_numerically_symmetric);
+ * 					  0 requires exact symmetry. Only the upper triangle is kept.
+ * @return	0 on success, -1 if the matrix is not symmetric (SYM is then left unallocated)
+ * */
+int 	convert_CSR_to_symmetric(SparseMatrix *CSR, SymmetricMatrix *SYM, double rtol);
+
+
+/**
+ * @brief	Sparse matrix-vector product y = A*x for a matrix in symmetric storage: each
+ * 			off-diagonal entry contributes to both its row and its column.
+ * 			Each thread owns a block of rows, balanced by nonzero count; the contributions
+ * 			to the rows of later blocks are accumulated in a private buffer covering only the
+ * 			columns the thread reaches, and the buffers are added afterwards. The buffers are
+ * 			small for banded (e.g. RCM-ordered) matrices.
+ * */
+void 	spmv_symmetric(const SymmetricMatrix *SYM, const double *x, double *y);
+
+
+void 	deallocate_symmetric_matrix(SymmetricMatrix *SYM);
+
+
+#endif
@@ -37,11 +37,41 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
 
 //Some useful macros
 #define INT_SIZE 		sizeof(int)
 #define DOUBLE_SIZE 	sizeof(double)
 
+/**
+ * Index type of the sparse matrices, selected at compile time: 32-bit indices by default,
+ * which halve the index traffic, or 64-bit indices when SPARSE_INDEX_64 is defined,
+ * for matrices with more than 2^31 - 1 rows, columns or nonzero entries.
+ * INDEX_TYPED(name) expands to the typed utility matching index_t, e.g. lower_bound_int64.*/
+#ifdef SPARSE_INDEX_64
+typedef int64_t 	index_t;
+#define INDEX_FMT 			"%" PRId64
+#define INDEX_MAX 			INT64_MAX
+#define INDEX_TYPED(name) 	name##_int64
+#else
+typedef int32_t 	index_t;
+#define INDEX_FMT 			"%" PRId32
+#define INDEX_MAX 			INT32_MAX
+#define INDEX_TYPED(name) 	name##_int32
+#endif
+
+#define INDEX_SIZE 		sizeof(index_t)
+
+/**
+ * Checks whether memory allocation is successful.
+ * The program will terminate in case the memory allocation fails.*/
+#define IS_POINTER_VALID(ptr) 													\
+	if (ptr == NULL) {															\
+		fprintf(stderr, "%s", "Memory allocation failed, aborting...\n");		\
+		exit(EXIT_FAILURE);														\
+	}	
+
 
 /**
  * @brief	This defines a function pointer to a comparator function.
@@ -93,7 +123,8 @@ int 	is_sorted(void *arr, size_t n, size_t element_size, comparator comp);
 
 
 /**
- * @brief Merges two sorted arrays arr1 and arr2 of length n1 and n2, respectively, into the array arr3.*/
+ * @brief Merges two sorted arrays arr1 and arr2 of length n1 and n2, respectively, into the array arr3.
+ * 		  arr3 may overlap arr1 or arr2.*/
 void 	merge_sorted_arrays(void *arr1, size_t n1, void *arr2, size_t n2, void *arr3, size_t element_size, comparator comp, int dir);
 
 /**
@@ -113,4 +144,126 @@ void 	*get_max(void *arr, size_t n, size_t element_size, comparator comp, int di
 void 	*get_min(void *arr, size_t n, size_t element_size, comparator comp, int dir);
 
 
+/**
+ * Type-specialized versions of the utilities above, generated for int32_t, int64_t and double.
+ * They take typed pointers, so that the compiler can inline and vectorize them, and they
+ * search within half-open ranges [low, high). For every suffix (int32, int64, double):
+ * 	is_sorted_ascending_<suffix>(arr, n), is_sorted_descending_<suffix>(arr, n)
+ * 	lower_bound_<suffix>(arr, n, key) 		: index of the first entry not smaller than key
+ * 	binary_search_<suffix>(arr, low, high, key) 	: index of key in [low, high), -1 if absent
+ * 	merge_sorted_arrays_<suffix>(arr1, n1, arr2, n2, out, dir) 	: out must not overlap the inputs
+ * 	get_max_index_<suffix>(arr, n, dir), get_min_index_<suffix>(arr, n, dir)
+ * As in the generic API, dir = 1 stands for ascending order, dir = 0 for descending order.
+ * */
+#define DEFINE_TYPED_UTILITIES(suffix, type)																							\
+	static inline int is_sorted_ascending_##suffix(const type *arr, size_t n) {															\
+		for (size_t i = 1; i < n; i++) {																								\
+			if (arr[i - 1] > arr[i]) {																									\
+				return 0;																												\
+			}																															\
+		}																																\
+		return 1;																														\
+	}																																	\
+	static inline int is_sorted_descending_##suffix(const type *arr, size_t n) {														\
+		for (size_t i = 1; i < n; i++) {																								\
+			if (arr[i - 1] < arr[i]) {																									\
+				return 0;																												\
+			}																															\
+		}																																\
+		return 1;																														\
+	}																																	\
+	/* Branchless: the comparison compiles to a conditional move, not a branch */														\
+	static inline size_t lower_bound_##suffix(const type *arr, size_t n, type key) {													\
+		if (n == 0) {																													\
+			return 0;																													\
+		}																																\
+		const type *base = arr;																											\
+		while (n > 1) {																													\
+			size_t half = n / 2;																										\
+			base = (base[half] < key) ? base + half : base;																				\
+			n -= half;																													\
+		}																																\
+		return (size_t)(base - arr) + (*base < key);																					\
+	}																																	\
+	static inline long binary_search_##suffix(const type *arr, size_t low, size_t high, type key) {										\
+		if (low >= high) {																												\
+			return -1;																													\
+		}																																\
+		size_t k = low + lower_bound_##suffix(arr + low, high - low, key);																\
+		return ((k < high) && (arr[k] == key)) ? (long)k : -1;																			\
+	}																																	\
+	static inline void merge_sorted_arrays_##suffix(const type *arr1, size_t n1, const type *arr2, size_t n2, type *out, int dir) {		\
+		size_t i = 0, j = 0, k = 0;																										\
+		while ((i < n1) && (j < n2)) {																									\
+			int take_first = dir ? (arr1[i] < arr2[j]) : (arr1[i] > arr2[j]);															\
+			out[k++] = take_first ? arr1[i++] : arr2[j++];																				\
+		}																																\
+		while (i < n1) {																												\
+			out[k++] = arr1[i++];																										\
+		}																																\
+		while (j < n2) {																												\
+			out[k++] = arr2[j++];																										\
+		}																																\
+	}																																	\
+	static inline size_t get_max_index_##suffix(const type *arr, size_t n, int dir) {													\
+		if ((dir == 1) || (dir == 0) || (n == 0)) {																						\
+			return ((dir == 1) && (n > 0)) ? n - 1 : 0;																					\
+		}																																\
+		size_t j = 0;																													\
+		for (size_t i = 1; i < n; i++) {																								\
+			j = (arr[i] > arr[j]) ? i : j;																								\
+		}																																\
+		return j;																														\
+	}																																	\
+	static inline size_t get_min_index_##suffix(const type *arr, size_t n, int dir) {													\
+		if ((dir == 1) || (dir == 0) || (n == 0)) {																						\
+			return ((dir == 0) && (n > 0)) ? n - 1 : 0;																					\
+		}																																\
+		size_t j = 0;																													\
+		for (size_t i = 1; i < n; i++) {																								\
+			j = (arr[i] < arr[j]) ? i : j;																								\
+		}																																\
+		return j;																														\
+	}
+
+DEFINE_TYPED_UTILITIES(int32, int32_t)
+DEFINE_TYPED_UTILITIES(int64, int64_t)
+DEFINE_TYPED_UTILITIES(double, double)
+
+#define lower_bound_index 		INDEX_TYPED(lower_bound)
+#define binary_search_index 	INDEX_TYPED(binary_search)
+#define is_sorted_ascending_index 	INDEX_TYPED(is_sorted_ascending)
+
+
+//Number of bits sorted per pass by the radix sort
+#define RADIX_BITS 		11
+#define RADIX_BUCKETS 	(1 << RADIX_BITS)
+
+/**
+ * @brief	Parallel, stable LSD radix sort of n keys in ascending order; the payload
+ * 			entries are moved along with their keys.
+ * @param	key_bits 	: number of significant (low) bits of the keys; only
+ * 						  ceil(key_bits / RADIX_BITS) passes are performed
+ * */
+void 	radix_sort_pairs(uint64_t *key, index_t *payload, size_t n, int key_bits);
+
+
+//Alignment of the matrix storage blocks: one cache line, and one AVX-512 register
+#define MEMORY_ALIGNMENT 	64
+#define HUGEPAGE_SIZE 		((size_t)2 << 20)
+#define ALIGN_UP(n, align) 	((((n) + (align) - 1) / (align)) * (align))
+
+//Flags of allocate_aligned()
+#define ALLOC_ZERO 			1		//zero the block, as calloc() does
+#define ALLOC_HUGEPAGES 	2		//back blocks of at least HUGEPAGE_SIZE bytes with transparent huge pages
+
+/**
+ * @brief	Allocates a block of at least size bytes aligned to MEMORY_ALIGNMENT, released with free().
+ * 			With ALLOC_HUGEPAGES, large blocks are aligned to HUGEPAGE_SIZE and advised with
+ * 			madvise(MADV_HUGEPAGE) where available; the advice is a hint and may be ignored.
+ * @return	the block; the program is terminated if the allocation fails
+ * */
+void 	*allocate_aligned(size_t size, int flags);
+
+
 #endif
\ No newline at end of file
@@ -1,49 +0,0 @@
-
-
- # This project presents the implementation of basic sparse matrix operations.
- #
- # Copyright (C) 2024, Rico Morasata.
- #
- # This program is free software: you can redistribute it and/or modify
- # it under the terms of the GNU General Public License as published by
- # the Free Software Foundation, either version 3 of the License, or
- # (at your option) any later version.
- #
- # This program is distributed in the hope that it will be useful,
- # but WITHOUT ANY WARRANTY; without even the implied warranty of
- # MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- # GNU General Public License for more details.
- #
- # You should have received a copy of the GNU General Public License
- # along with this program.  If not, see <https://www.gnu.org/licenses/>.
- #
- # DISCLAIMER OF LIABILITY
- #
- # THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
- # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
- # WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
- # DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
- # DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
- # (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
- # LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
- # ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
- # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
- # SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
- 
-
-set terminal pngcairo dashed font "Helvetica,10" size 600, 600
-set output 'sparse_matrix_plot.png'
-set title 'sparsity pattern'
-
-set size square
-unset key
-
-set xtics scale 0.2
-set ytics nomirror scale 0.2 
-set pm3d map interpolate 0,0
-
-set xrange [0:n] 
-set yrange [n:0] 
-
-splot 'mat_data.dat' using 1:2:3 w p ps .5 lc rgb "blue" pt 7 
-
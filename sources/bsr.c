@@ -0,0 +1,372 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "bsr.h"
+#include "instrument.h"
+
+
+#define CEIL_DIV(n, d) 	(((n) + (d) - 1) / (d))
+
+//Bytes of the block row pointers, block columns and blocks of a BSR matrix
+#define BSR_BYTES(BSR) 	(((uint64_t)(BSR)->nbr + 1) * INDEX_SIZE + (uint64_t)(BSR)->nnzb * (INDEX_SIZE + (uint64_t)(BSR)->r * (BSR)->c * DOUBLE_SIZE))
+
+
+static int compare_index(const void *a, const void *b) {
+
+	index_t x = *(const index_t *)a;
+	index_t y = *(const index_t *)b;
+	return (x > y) - (x < y);
+}
+
+
+/**
+ * Number of distinct block columns of block row I. marker has one entry per block column, and
+ * marker[J] == I once block column J has been seen in this block row, so it never needs a reset
+ * as long as each block row is scanned at most once with the same marker array.
+ * If cols is not NULL, the block columns are written to it in order of appearance.*/
+static index_t scan_block_row(const SparseMatrix *CSR, index_t I, int r, int c, index_t *marker, index_t *cols) {
+
+	index_t count 		= 0;
+	index_t row_end 	= ((I + 1) * r < CSR->nr) ? (I + 1) * r : CSR->nr;
+
+	for (index_t i = I * r; i < row_end; i++) {
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+			index_t J = CSR->ja[j] / c;
+			if (marker[J] != I) {
+				marker[J] = I;
+				if (cols) {
+					cols[count] = J;
+				}
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+
+//Number of nonzero blocks of the r x c block structure
+static index_t count_blocks(const SparseMatrix *CSR, int r, int c) {
+
+	index_t nbr 	= CEIL_DIV(CSR->nr, r);
+	index_t nbc 	= CEIL_DIV(CSR->nc, c);
+	index_t nnzb 	= 0;
+
+	#pragma omp parallel reduction(+:nnzb) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		index_t *marker = malloc(((size_t)nbc + 1) * INDEX_SIZE);
+		IS_POINTER_VALID(marker);
+		memset(marker, 0xff, ((size_t)nbc + 1) * INDEX_SIZE);
+
+		#pragma omp for schedule(static)
+		for (index_t I = 0; I < nbr; I++) {
+			nnzb += scan_block_row(CSR, I, r, c, marker, NULL);
+		}
+
+		free(marker);
+	}
+	return nnzb;
+}
+
+
+double BSR_fill_ratio(const SparseMatrix *CSR, int r, int c) {
+
+	if (CSR->nnz == 0) {
+		return 1.0;
+	}
+	return (double)count_blocks(CSR, r, c) * r * c / CSR->nnz;
+}
+
+
+int select_BSR_block_size(const SparseMatrix *CSR) {
+
+	int 	best 		= 1;
+	double 	best_bytes 	= (double)CSR->nnz * (DOUBLE_SIZE + INDEX_SIZE) + (double)(CSR->nr + 1) * INDEX_SIZE;
+
+	for (int b = 2; b <= BSR_MAX_BLOCK_SIZE; b++) {
+
+		if ((CSR->nr % b != 0) || (CSR->nc % b != 0)) {
+			continue;
+		}
+
+		double nnzb 	= (double)count_blocks(CSR, b, b);
+		double bytes 	= nnzb * (b * b * DOUBLE_SIZE + INDEX_SIZE) + (double)(CSR->nr / b + 1) * INDEX_SIZE;
+		if (bytes < best_bytes) {
+			best 		= b;
+			best_bytes 	= bytes;
+		}
+	}
+	return best;
+}
+
+
+void convert_CSR_to_BSR(const SparseMatrix *CSR, BsrMatrix *BSR, int r, int c) {
+
+	INSTRUMENT_BEGIN();
+
+	BSR->nr 	= CSR->nr;
+	BSR->nc 	= CSR->nc;
+	BSR->nnz 	= CSR->nnz;
+	BSR->r 		= r;
+	BSR->c 		= c;
+	BSR->nbr 	= CEIL_DIV(CSR->nr, r);
+	BSR->nbc 	= CEIL_DIV(CSR->nc, c);
+
+	index_t nbr 	= BSR->nbr;
+	index_t nbc 	= BSR->nbc;
+	size_t 	bsize 	= (size_t)r * c;
+
+	BSR->ia = malloc(((size_t)nbr + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(BSR->ia);
+
+	//Step 1: number of blocks of every block row, and block row pointers
+	#pragma omp parallel if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		index_t *marker = malloc(((size_t)nbc + 1) * INDEX_SIZE);
+		IS_POINTER_VALID(marker);
+		memset(marker, 0xff, ((size_t)nbc + 1) * INDEX_SIZE);
+
+		#pragma omp for schedule(static)
+		for (index_t I = 0; I < nbr; I++) {
+			BSR->ia[I] = scan_block_row(CSR, I, r, c, marker, NULL);
+		}
+
+		free(marker);
+	}
+
+	BSR->ia[nbr] 	= 0;
+	BSR->nnzb 		= parallel_exclusive_scan(BSR->ia, nbr + 1);
+
+	BSR->ja = allocate_aligned((size_t)BSR->nnzb * INDEX_SIZE, 0);
+	BSR->a 	= allocate_aligned((size_t)BSR->nnzb * bsize * DOUBLE_SIZE, ALLOC_ZERO);
+
+	//Step 2: sorted block columns of every block row, then scatter of the values into the blocks
+	#pragma omp parallel if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		index_t *marker 	= malloc(((size_t)nbc + 1) * INDEX_SIZE);
+		index_t *position 	= malloc(((size_t)nbc + 1) * INDEX_SIZE);
+		IS_POINTER_VALID(marker);
+		IS_POINTER_VALID(position);
+		memset(marker, 0xff, ((size_t)nbc + 1) * INDEX_SIZE);
+
+		#pragma omp for schedule(dynamic, 64)
+		for (index_t I = 0; I < nbr; I++) {
+
+			index_t *cols 	= BSR->ja + BSR->ia[I];
+			index_t count 	= scan_block_row(CSR, I, r, c, marker, cols);
+			qsort(cols, count, INDEX_SIZE, compare_index);
+
+			for (index_t k = 0; k < count; k++) {
+				position[cols[k]] = BSR->ia[I] + k;
+			}
+
+			index_t row_end = ((I + 1) * r < CSR->nr) ? (I + 1) * r : CSR->nr;
+			for (index_t i = I * r; i < row_end; i++) {
+				for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+					index_t col = CSR->ja[j];
+					double *blk = BSR->a + (size_t)position[col / c] * bsize;
+					blk[(i - I * r) * c + (col % c)] = CSR->a[j];
+				}
+			}
+		}
+
+		free(marker);
+		free(position);
+	}
+
+	INSTRUMENT_END(OP_CSR_TO_BSR, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + BSR_BYTES(BSR), CSR->nnz);
+}
+
+
+void convert_BSR_to_CSR(const BsrMatrix *BSR, SparseMatrix *CSR) {
+
+	INSTRUMENT_BEGIN();
+
+	int r 		= BSR->r;
+	int c 		= BSR->c;
+	size_t bsize 	= (size_t)r * c;
+
+	CSR->nr 	= BSR->nr;
+	CSR->nc 	= BSR->nc;
+
+	index_t *row_nnz = malloc(((size_t)BSR->nr + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(row_nnz);
+
+	//Step 1: count the nonzero entries of every row; padding rows and columns only hold zeros
+	#pragma omp parallel for schedule(static) if (BSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t I = 0; I < BSR->nbr; I++) {
+
+		for (int ii = 0; (ii < r) && (I * r + ii < BSR->nr); ii++) {
+
+			index_t count = 0;
+			for (index_t k = BSR->ia[I]; k < BSR->ia[I + 1]; k++) {
+				const double *blk = BSR->a + (size_t)k * bsize + (size_t)ii * c;
+				for (int jj = 0; jj < c; jj++) {
+					count += (blk[jj] != 0.0);
+				}
+			}
+			row_nnz[I * r + ii] = count;
+		}
+	}
+
+	row_nnz[BSR->nr] 	= 0;
+	CSR->nnz 			= parallel_exclusive_scan(row_nnz, BSR->nr + 1);
+	reset_matrix_storage(CSR);
+	reserve_CSR_matrix(CSR, 0);
+	memcpy(CSR->ia, row_nnz, ((size_t)BSR->nr + 1) * INDEX_SIZE);
+	free(row_nnz);
+
+	//Step 2: copy the entries; the block columns are sorted, so the columns come out sorted
+	#pragma omp parallel for schedule(static) if (BSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t I = 0; I < BSR->nbr; I++) {
+
+		for (int ii = 0; (ii < r) && (I * r + ii < BSR->nr); ii++) {
+
+			index_t pos = CSR->ia[I * r + ii];
+			for (index_t k = BSR->ia[I]; k < BSR->ia[I + 1]; k++) {
+				const double *blk = BSR->a + (size_t)k * bsize + (size_t)ii * c;
+				for (int jj = 0; jj < c; jj++) {
+					if (blk[jj] != 0.0) {
+						CSR->ja[pos] 	= BSR->ja[k] * c + jj;
+						CSR->a[pos] 	= blk[jj];
+						pos++;
+					}
+				}
+			}
+		}
+	}
+
+	INSTRUMENT_END(OP_BSR_TO_CSR, BSR_BYTES(BSR) + COMPRESSED_BYTES(CSR->nr, CSR->nnz), CSR->nnz);
+}
+
+
+/**
+ * Kernel for R x C blocks with compile-time dimensions: the loops over the block are fully
+ * unrolled, and the R partial sums of a block row stay in registers.
+ * The blocks must not overhang the matrix, i.e. R and C must divide nr and nc.*/
+#define DEFINE_BSR_KERNEL(R, C) 																		\
+	static void spmv_BSR_##R##x##C(const BsrMatrix *BSR, const double *x, double *y, index_t begin, index_t end) {	\
+																										\
+		for (index_t I = begin; I < end; I++) { 														\
+																										\
+			double sum[R] = {0.0}; 																		\
+			for (index_t k = BSR->ia[I]; k < BSR->ia[I + 1]; k++) { 									\
+				const double *blk 	= BSR->a + (size_t)k * (R * C); 									\
+				const double *xb 	= x + (size_t)BSR->ja[k] * C; 										\
+				_Pragma("GCC unroll 8") 																\
+				for (int ii = 0; ii < R; ii++) { 														\
+					_Pragma("GCC unroll 8") 															\
+					for (int jj = 0; jj < C; jj++) { 													\
+						sum[ii] += blk[ii * C + jj] * xb[jj]; 											\
+					} 																					\
+				} 																						\
+			} 																							\
+																										\
+			_Pragma("GCC unroll 8") 																	\
+			for (int ii = 0; ii < R; ii++) { 															\
+				y[(size_t)I * R + ii] = sum[ii]; 														\
+			} 																							\
+		} 																								\
+	}
+
+DEFINE_BSR_KERNEL(2, 2)
+DEFINE_BSR_KERNEL(3, 3)
+DEFINE_BSR_KERNEL(4, 4)
+DEFINE_BSR_KERNEL(6, 6)
+DEFINE_BSR_KERNEL(8, 8)
+
+
+//Generic kernel for any block size, clipping the padding of the last block row and column
+static void spmv_BSR_generic(const BsrMatrix *BSR, const double *x, double *y, index_t begin, index_t end) {
+
+	int r = BSR->r;
+	int c = BSR->c;
+
+	for (index_t I = begin; I < end; I++) {
+
+		int rows = (I * r + r <= BSR->nr) ? r : (int)(BSR->nr - I * r);
+		for (int ii = 0; ii < rows; ii++) {
+
+			double sum = 0.0;
+			for (index_t k = BSR->ia[I]; k < BSR->ia[I + 1]; k++) {
+				index_t col0 		= BSR->ja[k] * c;
+				int cols 			= (col0 + c <= BSR->nc) ? c : (int)(BSR->nc - col0);
+				const double *blk 	= BSR->a + ((size_t)k * r + ii) * c;
+				for (int jj = 0; jj < cols; jj++) {
+					sum += blk[jj] * x[col0 + jj];
+				}
+			}
+			y[(size_t)I * r + ii] = sum;
+		}
+	}
+}
+
+
+void spmv_BSR(const BsrMatrix *BSR, const double *x, double *y) {
+
+	INSTRUMENT_BEGIN();
+
+	void (*kernel)(const BsrMatrix *, const double *, double *, index_t, index_t) = spmv_BSR_generic;
+
+	if ((BSR->r == BSR->c) && (BSR->nr % BSR->r == 0) && (BSR->nc % BSR->c == 0)) {
+		switch (BSR->r) {
+			case 2: kernel = spmv_BSR_2x2; break;
+			case 3: kernel = spmv_BSR_3x3; break;
+			case 4: kernel = spmv_BSR_4x4; break;
+			case 6: kernel = spmv_BSR_6x6; break;
+			case 8: kernel = spmv_BSR_8x8; break;
+			default: break;
+		}
+	}
+
+	#pragma omp parallel if (BSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+		index_t begin 	= nnz_balanced_row_split(BSR->ia, BSR->nbr, tid, nthreads);
+		index_t end 	= nnz_balanced_row_split(BSR->ia, BSR->nbr, tid + 1, nthreads);
+
+		kernel(BSR, x, y, begin, end);
+	}
+
+	INSTRUMENT_END(OP_SPMV_BSR, BSR_BYTES(BSR) + VECTOR_BYTES(BSR->nr, BSR->nc), BSR->nnz);
+}
+
+
+void deallocate_BSR_matrix(BsrMatrix *BSR) {
+
+	free(BSR->ia);
+	free(BSR->ja);
+	free(BSR->a);
+}
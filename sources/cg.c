@@ -0,0 +1,321 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "cg.h"
+#include "instrument.h"
+
+
+int init_cg_workspace(const SparseMatrix *CSR, Preconditioner preconditioner, int max_iterations, CgWorkspace *ws) {
+
+	memset(ws, 0, sizeof(CgWorkspace));
+
+	if (CSR->nr != CSR->nc) {
+		fprintf(stderr, "init_cg_workspace: the matrix is not square.\n");
+		return -1;
+	}
+
+	index_t n = CSR->nr;
+	ws->n 				= n;
+	ws->max_iterations 	= (max_iterations > 0) ? max_iterations : 0;
+	ws->preconditioner 	= preconditioner;
+
+	ws->r 				= allocate_aligned((size_t)n * DOUBLE_SIZE, 0);
+	ws->p 				= allocate_aligned((size_t)n * DOUBLE_SIZE, 0);
+	ws->Ap 				= allocate_aligned((size_t)n * DOUBLE_SIZE, 0);
+	ws->iteration_time 	= calloc(ws->max_iterations + 1, DOUBLE_SIZE);
+	ws->residual_norm 	= calloc(ws->max_iterations + 1, DOUBLE_SIZE);
+	IS_POINTER_VALID(ws->iteration_time);
+	IS_POINTER_VALID(ws->residual_norm);
+
+	if (preconditioner == PRECONDITIONER_JACOBI) {
+		ws->z 			= allocate_aligned((size_t)n * DOUBLE_SIZE, 0);
+		ws->inv_diag 	= allocate_aligned((size_t)n * DOUBLE_SIZE, 0);
+		if (update_cg_preconditioner(CSR, ws) != 0) {
+			deallocate_cg_workspace(ws);
+			return -1;
+		}
+	}
+	else {
+		ws->z = ws->r;
+	}
+	return 0;
+}
+
+
+int update_cg_preconditioner(const SparseMatrix *CSR, CgWorkspace *ws) {
+
+	if (ws->preconditioner != PRECONDITIONER_JACOBI) {
+		return 0;
+	}
+
+	const index_t 	*ia 		= CSR->ia;
+	const index_t 	*ja 		= CSR->ja;
+	const double 	*a 			= CSR->a;
+	int 			missing 	= 0;
+
+	#pragma omp parallel for schedule(static) reduction(+ : missing) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < ws->n; i++) {
+
+		double diag = 0.0;
+		for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+			if (ja[j] == i) {
+				diag += a[j];
+			}
+		}
+		missing 		+= (diag == 0.0);
+		ws->inv_diag[i] = (diag != 0.0) ? 1.0 / diag : 0.0;
+	}
+
+	if (missing > 0) {
+		fprintf(stderr, "Jacobi preconditioner: %d zero or missing diagonal entries.\n", missing);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * r = b - A*x, z = M^-1 r and p = z in one pass over the matrix.
+ * Returns r.z, r.r and b.b in sums.*/
+static void residual_pass(const SparseMatrix *CSR, CgWorkspace *ws, const double *b, const double *x, double sums[3]) {
+
+	const index_t 	*ia 	= CSR->ia;
+	const index_t 	*ja 	= CSR->ja;
+	const double 	*a 		= CSR->a;
+	int 			jacobi 	= (ws->preconditioner == PRECONDITIONER_JACOBI);
+	double 			rz 		= 0.0;
+	double 			rr 		= 0.0;
+	double 			bb 		= 0.0;
+
+	#pragma omp parallel reduction(+ : rz, rr, bb) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+
+		index_t row_begin 	= nnz_balanced_row_split(ia, CSR->nr, tid, nthreads);
+		index_t row_end 	= nnz_balanced_row_split(ia, CSR->nr, tid + 1, nthreads);
+
+		for (index_t i = row_begin; i < row_end; i++) {
+
+			double sum = 0.0;
+			for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+				sum += a[j] * x[ja[j]];
+			}
+
+			double r 	= b[i] - sum;
+			double z 	= jacobi ? ws->inv_diag[i] * r : r;
+			ws->r[i] 	= r;
+			ws->z[i] 	= z;
+			ws->p[i] 	= z;
+			rz 			+= r * z;
+			rr 			+= r * r;
+			bb 			+= b[i] * b[i];
+		}
+	}
+
+	sums[0] = rz;
+	sums[1] = rr;
+	sums[2] = bb;
+}
+
+
+//Ap = A*p, returning p.Ap computed in the same pass
+static double spmv_dot(const SparseMatrix *CSR, const double *p, double *Ap) {
+
+	const index_t 	*ia 	= CSR->ia;
+	const index_t 	*ja 	= CSR->ja;
+	const double 	*a 		= CSR->a;
+	double 			pAp 	= 0.0;
+
+	#pragma omp parallel reduction(+ : pAp) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+
+		index_t row_begin 	= nnz_balanced_row_split(ia, CSR->nr, tid, nthreads);
+		index_t row_end 	= nnz_balanced_row_split(ia, CSR->nr, tid + 1, nthreads);
+
+		for (index_t i = row_begin; i < row_end; i++) {
+
+			double sum = 0.0;
+			for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+				sum += a[j] * p[ja[j]];
+			}
+			Ap[i] 	= sum;
+			pAp 	+= p[i] * sum;
+		}
+	}
+	return pAp;
+}
+
+
+//x += alpha p, r -= alpha Ap and z = M^-1 r in one pass, returning r.z and r.r
+static void update_pass(CgWorkspace *ws, double *x, double alpha, double *rz_out, double *rr_out) {
+
+	const double 	*p 			= ws->p;
+	const double 	*Ap 		= ws->Ap;
+	const double 	*inv_diag 	= ws->inv_diag;
+	double 			*r 			= ws->r;
+	double 			*z 			= ws->z;
+	double 			rz 			= 0.0;
+	double 			rr 			= 0.0;
+
+	if (ws->preconditioner == PRECONDITIONER_JACOBI) {
+
+		#pragma omp parallel for schedule(static) reduction(+ : rz, rr) if (ws->n > PARALLEL_NNZ_THRESHOLD)
+		for (index_t i = 0; i < ws->n; i++) {
+			x[i] 	+= alpha * p[i];
+			r[i] 	-= alpha * Ap[i];
+			z[i] 	= inv_diag[i] * r[i];
+			rz 		+= r[i] * z[i];
+			rr 		+= r[i] * r[i];
+		}
+	}
+	else {
+
+		#pragma omp parallel for schedule(static) reduction(+ : rr) if (ws->n > PARALLEL_NNZ_THRESHOLD)
+		for (index_t i = 0; i < ws->n; i++) {
+			x[i] 	+= alpha * p[i];
+			r[i] 	-= alpha * Ap[i];
+			rr 		+= r[i] * r[i];
+		}
+		rz = rr;
+	}
+
+	*rz_out = rz;
+	*rr_out = rr;
+}
+
+
+//p = z + beta p
+static void direction_pass(CgWorkspace *ws, double beta) {
+
+	const double 	*z = ws->z;
+	double 			*p = ws->p;
+
+	#pragma omp parallel for schedule(static) if (ws->n > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < ws->n; i++) {
+		p[i] = z[i] + beta * p[i];
+	}
+}
+
+
+int cg_solve(const SparseMatrix *CSR, CgWorkspace *ws, const double *b, double *x, double rtol, CgResult *result) {
+
+	INSTRUMENT_BEGIN();
+
+	memset(result, 0, sizeof(CgResult));
+
+	if ((CSR->nr != ws->n) || (CSR->nc != ws->n)) {
+		fprintf(stderr, "cg_solve: the workspace was set up for another matrix size.\n");
+		return -1;
+	}
+
+	double start = instrument_clock();
+
+	//Step 1: initial residual, preconditioned residual and search direction
+	double sums[3];
+	residual_pass(CSR, ws, b, x, sums);
+
+	double rz 		= sums[0];
+	double rr 		= sums[1];
+	double target 	= rtol * sqrt(sums[2]);
+	int 	k 		= 0;
+	int 	converged = (sqrt(rr) <= target);
+
+	result->setup_time = instrument_clock() - start;
+
+	//Step 2: iterations, three passes each
+	while (!converged && (k < ws->max_iterations)) {
+
+		double iteration_start = instrument_clock();
+
+		double pAp = spmv_dot(CSR, ws->p, ws->Ap);
+		if (!(pAp > 0.0)) {
+			fprintf(stderr, "cg_solve: breakdown (p.Ap = %g), the matrix is not positive definite.\n", pAp);
+			break;
+		}
+
+		double alpha = rz / pAp;
+		double rz_new;
+		update_pass(ws, x, alpha, &rz_new, &rr);
+
+		converged = (sqrt(rr) <= target);
+		if (!converged) {
+			direction_pass(ws, rz_new / rz);
+		}
+		rz = rz_new;
+
+		ws->iteration_time[k] 	= instrument_clock() - iteration_start;
+		ws->residual_norm[k] 	= sqrt(rr);
+		k++;
+	}
+
+	result->iterations 		= k;
+	result->converged 		= converged;
+	result->residual_norm 	= sqrt(rr);
+	result->solve_time 		= instrument_clock() - start;
+
+	INSTRUMENT_END(OP_CG_SOLVE, (uint64_t)(k + 1) * (COMPRESSED_BYTES(CSR->nr, CSR->nnz) + 13 * (uint64_t)CSR->nr * DOUBLE_SIZE), (uint64_t)(k + 1) * CSR->nnz);
+	return converged ? 0 : -1;
+}
+
+
+void print_cg_report(const CgWorkspace *ws, const CgResult *result, FILE *out) {
+
+	fprintf(out, "CG (%s): %s after %d iterations, ||r|| = %.6e, setup %.6f s, total %.6f s\n",
+			(ws->preconditioner == PRECONDITIONER_JACOBI) ? "Jacobi" : "no preconditioner",
+			result->converged ? "converged" : "not converged", result->iterations,
+			result->residual_norm, result->setup_time, result->solve_time);
+
+	fprintf(out, "iteration,time_s,residual_norm\n");
+	for (int k = 0; k < result->iterations; k++) {
+		fprintf(out, "%d,%.6e,%.6e\n", k + 1, ws->iteration_time[k], ws->residual_norm[k]);
+	}
+}
+
+
+void deallocate_cg_workspace(CgWorkspace *ws) {
+
+	if (ws->z != ws->r) {
+		free(ws->z);
+	}
+	free(ws->r);
+	free(ws->p);
+	free(ws->Ap);
+	free(ws->inv_diag);
+	free(ws->iteration_time);
+	free(ws->residual_norm);
+	memset(ws, 0, sizeof(CgWorkspace));
+}
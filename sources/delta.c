@@ -0,0 +1,315 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "delta.h"
+#include "instrument.h"
+
+//Bytes per value of each storage precision
+static const size_t value_size[] = {8, 4, 2};
+
+//Largest difference stored on w bytes
+#define DELTA_MAX(w) 	(((index_t)1 << (8 * (w))) - 1)
+
+//The first column of row i is a difference with this origin, so that it fits when near the diagonal
+#define ROW_ORIGIN(i, w) 	((i) - ((index_t)1 << (8 * (w) - 1)))
+
+
+//Rounds to the nearest bfloat16, ties to even; NaNs stay (quiet) NaNs
+static uint16_t double_to_bf16(double v) {
+
+	float 		f = (float)v;
+	uint32_t 	bits;
+	memcpy(&bits, &f, sizeof(bits));
+
+	if ((bits & 0x7fffffffu) > 0x7f800000u) {
+		return (uint16_t)((bits >> 16) | 0x40);
+	}
+	bits += 0x7fffu + ((bits >> 16) & 1);
+	return (uint16_t)(bits >> 16);
+}
+
+
+static inline double bf16_to_double(uint16_t h) {
+
+	uint32_t 	bits = (uint32_t)h << 16;
+	float 		f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+
+//1 if the column cannot be stored as a difference of w bytes with the previous column
+static inline int needs_escape(index_t col, index_t prev, int w) {
+
+	index_t d = col - prev;
+	return (d < 1) || (d > DELTA_MAX(w));
+}
+
+
+void convert_CSR_to_DELTA(const SparseMatrix *CSR, DeltaMatrix *DELTA, ValuePrecision precision) {
+
+	INSTRUMENT_BEGIN();
+
+	const index_t 	*ia = CSR->ia;
+	const index_t 	*ja = CSR->ja;
+	index_t 		nr 	= CSR->nr;
+	index_t 		c;
+
+	DELTA->nr 			= nr;
+	DELTA->nc 			= CSR->nc;
+	DELTA->nnz 			= CSR->nnz;
+	DELTA->nchunks 		= (nr + DELTA_CHUNK_ROWS - 1) / DELTA_CHUNK_ROWS;
+	DELTA->precision 	= precision;
+
+	index_t nchunks = DELTA->nchunks;
+
+	DELTA->ia 			= malloc((nr + 1) * INDEX_SIZE);
+	DELTA->width 		= malloc(nchunks + 1);
+	DELTA->delta_ptr 	= malloc((nchunks + 1) * sizeof(size_t));
+	DELTA->escape_ptr 	= malloc((nchunks + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(DELTA->ia);
+	IS_POINTER_VALID(DELTA->width);
+	IS_POINTER_VALID(DELTA->delta_ptr);
+	IS_POINTER_VALID(DELTA->escape_ptr);
+
+	memcpy(DELTA->ia, ia, (nr + 1) * INDEX_SIZE);
+
+	//Step 1: width of each chunk, whichever of 8 and 16 bits takes fewer bytes with its escapes
+	#pragma omp parallel for schedule(static) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (c = 0; c < nchunks; c++) {
+
+		index_t row_begin 	= c * DELTA_CHUNK_ROWS;
+		index_t row_end 	= (nr - row_begin < DELTA_CHUNK_ROWS) ? nr : row_begin + DELTA_CHUNK_ROWS;
+		index_t escapes[2] 	= {0, 0};
+
+		for (index_t i = row_begin; i < row_end; i++) {
+			for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+				escapes[0] 	+= needs_escape(ja[j], (j == ia[i]) ? ROW_ORIGIN(i, 1) : ja[j - 1], 1);
+				escapes[1] 	+= needs_escape(ja[j], (j == ia[i]) ? ROW_ORIGIN(i, 2) : ja[j - 1], 2);
+			}
+		}
+
+		size_t n = ia[row_end] - ia[row_begin];
+		int w 	 = (n + escapes[0] * INDEX_SIZE <= 2 * n + escapes[1] * INDEX_SIZE) ? 1 : 2;
+
+		DELTA->width[c] 			= (uint8_t)w;
+		DELTA->delta_ptr[c + 1] 	= ALIGN_UP(n * w, 2);
+		DELTA->escape_ptr[c + 1] 	= escapes[w - 1];
+	}
+
+	//Step 2: offsets of the chunks
+	DELTA->delta_ptr[0] 	= 0;
+	DELTA->escape_ptr[0] 	= 0;
+	for (c = 0; c < nchunks; c++) {
+		DELTA->delta_ptr[c + 1] 	+= DELTA->delta_ptr[c];
+		DELTA->escape_ptr[c + 1] 	+= DELTA->escape_ptr[c];
+	}
+
+	//Step 3: encode the columns and round the values. The escape array has one spare entry,
+	//since the decoder loads the next escaped column ahead of every entry
+	DELTA->deltas 	= allocate_aligned(DELTA->delta_ptr[nchunks], 0);
+	DELTA->escape 	= allocate_aligned((DELTA->escape_ptr[nchunks] + 1) * INDEX_SIZE, ALLOC_ZERO);
+	DELTA->a 		= allocate_aligned((size_t)CSR->nnz * value_size[precision], 0);
+
+	#pragma omp parallel for schedule(static) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (c = 0; c < nchunks; c++) {
+
+		index_t row_begin 	= c * DELTA_CHUNK_ROWS;
+		index_t row_end 	= (nr - row_begin < DELTA_CHUNK_ROWS) ? nr : row_begin + DELTA_CHUNK_ROWS;
+		index_t first 		= ia[row_begin];
+		int 	w 			= DELTA->width[c];
+		uint8_t *d8 		= DELTA->deltas + DELTA->delta_ptr[c];
+		uint16_t *d16 		= (uint16_t *)d8;
+		index_t *escape 	= DELTA->escape + DELTA->escape_ptr[c];
+
+		for (index_t i = row_begin; i < row_end; i++) {
+			index_t prev = ROW_ORIGIN(i, w);
+			for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+
+				index_t d = needs_escape(ja[j], prev, w) ? DELTA_ESCAPE : ja[j] - prev;
+				if (d == DELTA_ESCAPE) {
+					*escape++ = ja[j];
+				}
+				if (w == 1) {
+					d8[j - first] = (uint8_t)d;
+				}
+				else {
+					d16[j - first] = (uint16_t)d;
+				}
+				prev = ja[j];
+			}
+		}
+
+		for (index_t j = first; j < ia[row_end]; j++) {
+			if (precision == VALUE_DOUBLE) {
+				((double *)DELTA->a)[j] = CSR->a[j];
+			}
+			else if (precision == VALUE_FLOAT) {
+				((float *)DELTA->a)[j] = (float)CSR->a[j];
+			}
+			else {
+				((uint16_t *)DELTA->a)[j] = double_to_bf16(CSR->a[j]);
+			}
+		}
+	}
+
+	INSTRUMENT_END(OP_CSR_TO_DELTA, COMPRESSED_BYTES(nr, CSR->nnz) + DELTA_bytes(DELTA), CSR->nnz);
+}
+
+
+size_t DELTA_bytes(const DeltaMatrix *DELTA) {
+
+	return ((size_t)DELTA->nr + 1) * INDEX_SIZE + DELTA->nchunks
+		   + ((size_t)DELTA->nchunks + 1) * (sizeof(size_t) + INDEX_SIZE)
+		   + DELTA->delta_ptr[DELTA->nchunks] + (size_t)DELTA->escape_ptr[DELTA->nchunks] * INDEX_SIZE
+		   + (size_t)DELTA->nnz * value_size[DELTA->precision];
+}
+
+
+double DELTA_compression_ratio(const DeltaMatrix *DELTA) {
+
+	return (double)COMPRESSED_BYTES(DELTA->nr, DELTA->nnz) / DELTA_bytes(DELTA);
+}
+
+
+void print_DELTA_report(const DeltaMatrix *DELTA, FILE *out) {
+
+	static const char *precision_name[] = {"double", "float", "bfloat16"};
+
+	index_t chunks8 = 0;
+	for (index_t c = 0; c < DELTA->nchunks; c++) {
+		chunks8 += (DELTA->width[c] == 1);
+	}
+
+	double nnz 		= (DELTA->nnz > 0) ? (double)DELTA->nnz : 1.0;
+	index_t escaped = DELTA->escape_ptr[DELTA->nchunks];
+
+	fprintf(out, "Delta-encoded CSR, %s values:\n", precision_name[DELTA->precision]);
+	fprintf(out, "  CSR size:          %" PRIu64 " bytes\n", (uint64_t)COMPRESSED_BYTES(DELTA->nr, DELTA->nnz));
+	fprintf(out, "  compressed size:   %zu bytes\n", DELTA_bytes(DELTA));
+	fprintf(out, "  compression ratio: %.2f\n", DELTA_compression_ratio(DELTA));
+	fprintf(out, "  column bytes/nnz:  %.2f (CSR: %d)\n",
+			(DELTA->delta_ptr[DELTA->nchunks] + (double)escaped * INDEX_SIZE) / nnz, (int)INDEX_SIZE);
+	fprintf(out, "  value bytes/nnz:   %zu (CSR: %d)\n", value_size[DELTA->precision], (int)DOUBLE_SIZE);
+	fprintf(out, "  chunks:            " INDEX_FMT " on 8 bits, " INDEX_FMT " on 16 bits\n", chunks8, DELTA->nchunks - chunks8);
+	fprintf(out, "  escaped entries:   " INDEX_FMT " (%.2f%%)\n", escaped, 100.0 * escaped / nnz);
+}
+
+
+/**
+ * Kernels for one chunk, for every pair of difference and value types. The next escaped column
+ * is loaded ahead of every entry, so that the choice between it and the difference needs no branch.*/
+#define DEFINE_DELTA_KERNEL(name, DELTA_T, VALUE_T, LOAD) 											\
+static void name(const DeltaMatrix *DELTA, index_t c, const double *x, double *y) { 				\
+																									\
+	const index_t 	*ia 	= DELTA->ia; 															\
+	const DELTA_T 	*delta 	= (const DELTA_T *)(DELTA->deltas + DELTA->delta_ptr[c]); 				\
+	const index_t 	*escape = DELTA->escape + DELTA->escape_ptr[c]; 								\
+	const VALUE_T 	*a 		= (const VALUE_T *)DELTA->a; 											\
+																									\
+	index_t row_begin 	= c * DELTA_CHUNK_ROWS; 													\
+	index_t row_end 	= (DELTA->nr - row_begin < DELTA_CHUNK_ROWS) ? DELTA->nr : row_begin + DELTA_CHUNK_ROWS; \
+	index_t first 		= ia[row_begin]; 															\
+	index_t k 			= 0; 																		\
+																									\
+	for (index_t i = row_begin; i < row_end; i++) { 												\
+																									\
+		index_t col = ROW_ORIGIN(i, (int)sizeof(DELTA_T)); 											\
+		double 	sum = 0.0; 																			\
+		for (index_t j = ia[i]; j < ia[i + 1]; j++) { 												\
+			index_t d 	= delta[j - first]; 														\
+			col 		= (d != DELTA_ESCAPE) ? col + d : escape[k]; 								\
+			k 			+= (d == DELTA_ESCAPE); 													\
+			sum 		+= LOAD(a[j]) * x[col]; 													\
+		} 																							\
+		y[i] = sum; 																				\
+	} 																								\
+}
+
+#define LOAD_DOUBLE(v) 	(v)
+#define LOAD_FLOAT(v) 	((double)(v))
+#define LOAD_BF16(v) 	bf16_to_double(v)
+
+DEFINE_DELTA_KERNEL(spmv_DELTA_double_8, 	uint8_t, 	double, 	LOAD_DOUBLE)
+DEFINE_DELTA_KERNEL(spmv_DELTA_double_16, 	uint16_t, 	double, 	LOAD_DOUBLE)
+DEFINE_DELTA_KERNEL(spmv_DELTA_float_8, 	uint8_t, 	float, 		LOAD_FLOAT)
+DEFINE_DELTA_KERNEL(spmv_DELTA_float_16, 	uint16_t, 	float, 		LOAD_FLOAT)
+DEFINE_DELTA_KERNEL(spmv_DELTA_bf16_8, 		uint8_t, 	uint16_t, 	LOAD_BF16)
+DEFINE_DELTA_KERNEL(spmv_DELTA_bf16_16, 	uint16_t, 	uint16_t, 	LOAD_BF16)
+
+#undef DEFINE_DELTA_KERNEL
+
+
+typedef void (*DeltaKernel)(const DeltaMatrix *DELTA, index_t c, const double *x, double *y);
+
+//Kernels indexed by precision and by width - 1
+static const DeltaKernel delta_kernel[3][2] = {
+	{spmv_DELTA_double_8, 	spmv_DELTA_double_16},
+	{spmv_DELTA_float_8, 	spmv_DELTA_float_16},
+	{spmv_DELTA_bf16_8, 	spmv_DELTA_bf16_16}
+};
+
+
+void spmv_DELTA(const DeltaMatrix *DELTA, const double *x, double *y) {
+
+	INSTRUMENT_BEGIN();
+
+	#pragma omp parallel if (DELTA->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+
+		//The nnz-balanced row blocks are rounded up to whole chunks
+		index_t chunk_begin = (nnz_balanced_row_split(DELTA->ia, DELTA->nr, tid, nthreads) + DELTA_CHUNK_ROWS - 1) / DELTA_CHUNK_ROWS;
+		index_t chunk_end 	= (nnz_balanced_row_split(DELTA->ia, DELTA->nr, tid + 1, nthreads) + DELTA_CHUNK_ROWS - 1) / DELTA_CHUNK_ROWS;
+
+		for (index_t c = chunk_begin; c < chunk_end; c++) {
+			delta_kernel[DELTA->precision][DELTA->width[c] - 1](DELTA, c, x, y);
+		}
+	}
+
+	INSTRUMENT_END(OP_SPMV_DELTA, DELTA_bytes(DELTA) + VECTOR_BYTES(DELTA->nr, DELTA->nc), DELTA->nnz);
+}
+
+
+void deallocate_DELTA_matrix(DeltaMatrix *DELTA) {
+
+	free(DELTA->ia);
+	free(DELTA->width);
+	free(DELTA->delta_ptr);
+	free(DELTA->escape_ptr);
+	free(DELTA->deltas);
+	free(DELTA->escape);
+	free(DELTA->a);
+}
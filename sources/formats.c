@@ -33,168 +33,568 @@
 
 
 #include "formats.h"
+#include "parallel.h"
+#include "instrument.h"
+#include "raster.h"
 
 
-/**For convenience, calloc() is called so that, upon successful memory allocation,
- * the array entries are initialized to zero.*/
-void allocate_COO_matrix(SparseMatrix *mat) {
+//Flags added to every matrix allocation
+static int default_allocation_flags = 0;
 
-	int *row_index	= calloc(mat->nnz , INT_SIZE);
-	IS_POINTER_VALID(row_index);
-	mat->ia = row_index; 
 
-	int *col_index	= calloc(mat->nnz , INT_SIZE);
-	IS_POINTER_VALID(row_index);
-	mat->ja = col_index; 
+void set_matrix_allocation_flags(int flags) {
 
-	double *val	= calloc(mat->nnz , DOUBLE_SIZE);
-	IS_POINTER_VALID(val);
-	mat->a = val; 
+	default_allocation_flags = flags;
 }
 
 
-void allocate_CSR_matrix(SparseMatrix *mat) {
+void reset_matrix_storage(SparseMatrix *mat) {
+
+	mat->ia 		= NULL;
+	mat->ja 		= NULL;
+	mat->a 			= NULL;
+	mat->mem 		= NULL;
+	mat->capacity 	= 0;
+}
+
 
-	int *row_ptr = calloc((mat->nr + 1) , INT_SIZE);
-	IS_POINTER_VALID(row_ptr);
-	mat->ia = row_ptr; 
+/**
+ * Places the ia (ia_length entries), ja (ja_length entries) and a (nnz entries) arrays in the
+ * storage block of the matrix, each one starting on a MEMORY_ALIGNMENT boundary. A block that
+ * is too small is freed and replaced, so matrices rebuilt with the same dimensions allocate once.*/
+static void reserve_storage(SparseMatrix *mat, index_t ia_length, index_t ja_length, int flags) {
+
+	size_t ia_bytes 	= ALIGN_UP((size_t)ia_length * INDEX_SIZE, MEMORY_ALIGNMENT);
+	size_t ja_bytes 	= ALIGN_UP((size_t)ja_length * INDEX_SIZE, MEMORY_ALIGNMENT);
+	size_t a_bytes 		= ALIGN_UP((size_t)mat->nnz * DOUBLE_SIZE, MEMORY_ALIGNMENT);
+	size_t size 		= ia_bytes + ja_bytes + a_bytes;
+
+	flags |= default_allocation_flags;
+
+	if ((mat->mem == NULL) || (mat->capacity < size)) {
+		if (mat->mem != NULL) {
+			INSTRUMENT_RELEASE(mat->capacity);
+		}
+		free(mat->mem);
+		mat->mem 		= allocate_aligned(size, flags & ~ALLOC_ZERO);
+		mat->capacity 	= size;
+		INSTRUMENT_ALLOCATION(size);
+	}
 
-	int *col_index = calloc(mat->nnz , INT_SIZE);
-	IS_POINTER_VALID(col_index);
-	mat->ja = col_index; 
+	char *base 	= (char *)mat->mem;
+	mat->ia 	= (index_t *)base;
+	mat->ja 	= (index_t *)(base + ia_bytes);
+	mat->a 		= (double *)(base + ia_bytes + ja_bytes);
 
-	double *val	= calloc(mat->nnz , DOUBLE_SIZE);
-	IS_POINTER_VALID(val);
-	mat->a = val; 
+	if (flags & ALLOC_ZERO) {
+		memset(base, 0, size);
+	}
 }
 
 
-void allocate_CSC_matrix(SparseMatrix *mat) {
+/**
+ * Grows the storage block of a matrix to size bytes, keeping its contents and the offsets of
+ * its arrays. realloc() extends large blocks by remapping their pages, so they are neither
+ * copied nor held twice; a block that comes back misaligned is moved to an aligned one.*/
+static void grow_storage(SparseMatrix *mat, size_t size) {
 
-	int *row_index	= calloc(mat->nnz , INT_SIZE);
-	IS_POINTER_VALID(row_index);
-	mat->ia = row_index; 
+	if (mat->capacity >= size) {
+		return;
+	}
+
+	size_t ia_offset 	= (char *)mat->ia - (char *)mat->mem;
+	size_t ja_offset 	= (char *)mat->ja - (char *)mat->mem;
+	size_t a_offset 	= (char *)mat->a - (char *)mat->mem;
 
-	int *col_ptr = calloc((mat->nr + 1) , INT_SIZE);
-	IS_POINTER_VALID(col_ptr);
-	mat->ja = col_ptr; 
+	void *block = realloc(mat->mem, size);
+	IS_POINTER_VALID(block);
 
-	double *val	= calloc(mat->nnz , DOUBLE_SIZE);
-	IS_POINTER_VALID(val);
-	mat->a = val; 
+	if ((uintptr_t)block % MEMORY_ALIGNMENT != 0) {
+		void *aligned = allocate_aligned(size, 0);
+		memcpy(aligned, block, mat->capacity);
+		free(block);
+		block = aligned;
+	}
+
+	INSTRUMENT_RELEASE(mat->capacity);
+	INSTRUMENT_ALLOCATION(size);
+
+	char *base 		= (char *)block;
+	mat->mem 		= block;
+	mat->capacity 	= size;
+	mat->ia 		= (index_t *)(base + ia_offset);
+	mat->ja 		= (index_t *)(base + ja_offset);
+	mat->a 			= (double *)(base + a_offset);
 }
 
 
-void count_nonzeros_per_row_CSR(SparseMatrix *CSR, int *nnz_per_row) {
+/**
+ * Finds room for a new row array of len entries in the storage block of mat, outside its ia,
+ * ja and a arrays (of ia_length, ja_length and nnz entries): at the start of the block, or after
+ * one of the arrays, e.g. in the row array left over by a previous conversion. Otherwise, if grow
+ * is set, the block is grown and the new array placed at its end; if not, NULL is returned.*/
+static index_t *find_row_array_room(SparseMatrix *mat, index_t ia_length, index_t ja_length, index_t len, int grow) {
+
+	char *base 		= (char *)mat->mem;
+	size_t begin[3] = {(char *)mat->ia - base, (char *)mat->ja - base, (char *)mat->a - base};
+	size_t end[3] 	= {begin[0] + (size_t)ia_length * INDEX_SIZE, begin[1] + (size_t)ja_length * INDEX_SIZE,
+					   begin[2] + (size_t)mat->nnz * DOUBLE_SIZE};
+	size_t bytes 	= (size_t)len * INDEX_SIZE;
+
+	size_t candidate[4] = {0, ALIGN_UP(end[0], MEMORY_ALIGNMENT), ALIGN_UP(end[1], MEMORY_ALIGNMENT), ALIGN_UP(end[2], MEMORY_ALIGNMENT)};
+	size_t last 		= 0;
+
+	for (int c = 0; c < 4; c++) {
+
+		int fits = (candidate[c] + bytes <= mat->capacity);
+		for (int k = 0; fits && (k < 3); k++) {
+			fits = (end[k] == begin[k]) || (candidate[c] + bytes <= begin[k]) || (candidate[c] >= end[k]);
+		}
+		if (fits) {
+			return (index_t *)(base + candidate[c]);
+		}
+		last = (candidate[c] > last) ? candidate[c] : last;
+	}
+
+	if (!grow) {
+		return NULL;
+	}
+	grow_storage(mat, last + bytes);
+	return (index_t *)((char *)mat->mem + last);
+}
+
+
+void reserve_COO_matrix(SparseMatrix *mat, int flags) {
+
+	reserve_storage(mat, mat->nnz, mat->nnz, flags);
+}
+
+
+void reserve_CSR_matrix(SparseMatrix *mat, int flags) {
+
+	reserve_storage(mat, mat->nr + 1, mat->nnz, flags);
+}
+
+
+void reserve_CSC_matrix(SparseMatrix *mat, int flags) {
+
+	reserve_storage(mat, mat->nnz, mat->nc + 1, flags);
+}
+
+
+void allocate_COO_matrix(SparseMatrix *mat) {
+
+	reset_matrix_storage(mat);
+	reserve_COO_matrix(mat, ALLOC_ZERO);
+}
 
-	for (int i = 0; i < CSR->nr; i++) {
+
+void allocate_CSR_matrix(SparseMatrix *mat) {
+
+	reset_matrix_storage(mat);
+	reserve_CSR_matrix(mat, ALLOC_ZERO);
+}
+
+
+void allocate_CSC_matrix(SparseMatrix *mat) {
+
+	reset_matrix_storage(mat);
+	reserve_CSC_matrix(mat, ALLOC_ZERO);
+}
+
+
+void count_nonzeros_per_row_CSR(SparseMatrix *CSR, index_t *nnz_per_row) {
+
+	for (index_t i = 0; i < CSR->nr; i++) {
 		nnz_per_row[i] = CSR->ia[i + 1] - CSR->ia[i];
 	}
 }
 
 
-void count_nonzeros_per_row_COO(SparseMatrix *COO, int *nnz_per_row) {
+//Row histogram: the entries do not need to be sorted, and empty rows are counted as zero.
+void count_nonzeros_per_row_COO(SparseMatrix *COO, index_t *nnz_per_row) {
 
-	int i, j, k, count;
+	memset(nnz_per_row, 0, COO->nr * INDEX_SIZE);
+	for (index_t k = 0; k < COO->nnz; k++) {
+		nnz_per_row[COO->ia[k]]++;
+	}
+}
 
-	i = 0;
-	j = 0;
-	count = 0;
 
-	while (i < COO->nr) {
-	
-		k = 1;
-		
-		while ((j < COO->nnz - 1) && (COO->ia[j] == COO->ia[j + 1])) {
-			
-			j++;
-			k++;
-
-			if ((COO->ia[j] != COO->ia[j + 1]) && (k >= 1)) {
-				break;
-			}
-		}
 
-		count += k;
-		j = count;
+//Row index of every entry, from the row pointers of a CSR matrix
+static void expand_row_pointers(const index_t *ptr, index_t nr, index_t *rows) {
 
-		nnz_per_row[i] = k;
-		i++;
+	#pragma omp parallel for schedule(dynamic, 256) if (ptr[nr] > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < nr; i++) {
+		for (index_t j = ptr[i]; j < ptr[i + 1]; j++) {
+			rows[j] = i;
+		}
 	}
+}
+
 
+//Row pointers (nr + 1 entries) of nnz entries sorted by row: row i starts at the first entry not above it
+static void compress_row_indices(const index_t *rows, index_t nnz, index_t nr, index_t *ptr) {
+
+	#pragma omp parallel for if (nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i <= nr; i++) {
+		ptr[i] = (index_t)INDEX_TYPED(lower_bound)(rows, nnz, i);
+	}
 }
 
 
+void convert_COO_to_CSR(SparseMatrix *COO, SparseMatrix *CSR) {
+
+	reset_matrix_storage(CSR);
+	convert_COO_to_CSR_into(COO, CSR);
+}
+
 
 //This function assumes that the COO matrix is sorted.
-void convert_COO_to_CSR(SparseMatrix *COO, SparseMatrix *CSR) {
+void convert_COO_to_CSR_into(SparseMatrix *COO, SparseMatrix *CSR) {
+
+	INSTRUMENT_BEGIN();
 
 	//Step 1: allocate CSR matrix
 	CSR->nr 	= COO->nr;
+	CSR->nc 	= COO->nc;
 	CSR->nnz 	= COO->nnz;
-	allocate_CSR_matrix(CSR);
+	reserve_CSR_matrix(CSR, 0);
 
 	//Step 2: copy data: the ja and a arrays will be the same
-	memcpy(CSR->ja, COO->ja, COO->nnz * INT_SIZE);
+	memcpy(CSR->ja, COO->ja, COO->nnz * INDEX_SIZE);
 	memcpy(CSR->a, COO->a, COO->nnz * DOUBLE_SIZE);
 
-	//Step 3: fill out the row pointer array in CSR
-	int *nzr = calloc(COO->nr, INT_SIZE);
-	IS_POINTER_VALID(nzr);
-	count_nonzeros_per_row_COO(COO, nzr);
-	
+	//Step 3: populate the ia array in CSR directly from the sorted row indices
+	compress_row_indices(COO->ia, COO->nnz, COO->nr, CSR->ia);
 
-	//Step 3: Populate the ia array in CSR
-	CSR->ia[0] = 0;
-	for (int i = 0; i < CSR->nr; i++) {
-		CSR->ia[i + 1] = CSR->ia[i] + nzr[i];
+	INSTRUMENT_END(OP_COO_TO_CSR, COO_BYTES(COO->nnz) + COMPRESSED_BYTES(CSR->nr, CSR->nnz), COO->nnz);
+}
+
+
+//Quicksort with an insertion sort for short rows; rows are usually short, so no allocation is made
+void sort_row_by_column(index_t *ja, double *a, index_t len) {
+
+	while (len > 16) {
+
+		//Quicksort with median-of-three pivot, recursing on the smaller half
+		index_t mid = len / 2;
+		index_t p1 = ja[0], p2 = ja[mid], p3 = ja[len - 1];
+		index_t pivot = (p1 < p2) ? ((p2 < p3) ? p2 : ((p1 < p3) ? p3 : p1))
+							  : ((p1 < p3) ? p1 : ((p2 < p3) ? p3 : p2));
+		index_t i = 0, j = len - 1;
+
+		while (i <= j) {
+			while (ja[i] < pivot) {
+				i++;
+			}
+			while (ja[j] > pivot) {
+				j--;
+			}
+			if (i <= j) {
+				index_t tc = ja[i]; ja[i] = ja[j]; ja[j] = tc;
+				double 	tv = a[i]; 	a[i] = a[j]; a[j] = tv;
+				i++;
+				j--;
+			}
+		}
+
+		if (j + 1 < len - i) {
+			sort_row_by_column(ja, a, j + 1);
+			ja 	+= i;
+			a 	+= i;
+			len -= i;
+		}
+		else {
+			sort_row_by_column(ja + i, a + i, len - i);
+			len = j + 1;
+		}
 	}
 
-	free(nzr);
+	//Insertion sort for short rows
+	for (index_t i = 1; i < len; i++) {
+		index_t col = ja[i];
+		double 	val = a[i];
+		index_t j 	= i - 1;
+		while ((j >= 0) && (ja[j] > col)) {
+			ja[j + 1] 	= ja[j];
+			a[j + 1] 	= a[j];
+			j--;
+		}
+		ja[j + 1] 	= col;
+		a[j + 1] 	= val;
+	}
 }
 
-//This implementation assumes that the COO matrix is stored in row major ordering.
+
+//Number of bits needed to represent the values 0, ..., n - 1
+static int index_bits(index_t n) {
+
+	int bits = 0;
+	while ((bits < 63) && (((int64_t)1 << bits) < n)) {
+		bits++;
+	}
+	return bits;
+}
+
+
+void convert_unsorted_COO_to_CSR(SparseMatrix *COO, SparseMatrix *CSR, int sum_duplicates) {
+
+	reset_matrix_storage(CSR);
+	convert_unsorted_COO_to_CSR_into(COO, CSR, sum_duplicates);
+}
+
+
+void convert_unsorted_COO_to_CSR_into(SparseMatrix *COO, SparseMatrix *CSR, int sum_duplicates) {
+
+	INSTRUMENT_BEGIN();
+
+	index_t nnz 	= COO->nnz;
+	int col_bits 	= index_bits(COO->nc);
+	int row_bits 	= index_bits(COO->nr);
+
+	//(row, column) pairs are packed into one key when they fit in 64 bits; otherwise the
+	//entries are sorted by column first, then (stably) by row.
+	int packed = (row_bits + col_bits <= 64);
+
+	//Step 1: sort the keys with an LSD radix sort, carrying the entry index
+	uint64_t 	*key 	= malloc((size_t)nnz * sizeof(uint64_t));
+	index_t 	*order 	= malloc((size_t)nnz * INDEX_SIZE);
+	IS_POINTER_VALID(key);
+	IS_POINTER_VALID(order);
+
+	#pragma omp parallel for if (nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t k = 0; k < nnz; k++) {
+		key[k] 		= packed ? ((uint64_t)COO->ia[k] << col_bits) | (uint64_t)COO->ja[k] : (uint64_t)COO->ja[k];
+		order[k] 	= k;
+	}
+
+	if (packed) {
+		radix_sort_pairs(key, order, nnz, row_bits + col_bits);
+	}
+	else {
+		radix_sort_pairs(key, order, nnz, col_bits);
+
+		#pragma omp parallel for if (nnz > PARALLEL_NNZ_THRESHOLD)
+		for (index_t k = 0; k < nnz; k++) {
+			key[k] = (uint64_t)COO->ia[order[k]];
+		}
+		radix_sort_pairs(key, order, nnz, row_bits);
+	}
+
+	uint64_t col_mask 	= packed ? (((uint64_t)1 << col_bits) - 1) : 0;
+	int row_shift 		= packed ? col_bits : 0;
+
+	#define ENTRY_ROW(k) 	((index_t)(key[k] >> row_shift))
+	#define ENTRY_COL(k) 	(packed ? (index_t)(key[k] & col_mask) : COO->ja[order[k]])
+	#define SAME_ENTRY(k, m) 	((key[k] == key[m]) && (ENTRY_COL(k) == ENTRY_COL(m)))
+
+	//Step 2: count the distinct entries; duplicates are now adjacent
+	int max_threads = get_max_threads();
+	int team_size 	= 1;
+	index_t thread_offset[max_threads + 1];
+
+	#pragma omp parallel num_threads(max_threads) if (nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+		index_t begin 	= BLOCK_BEGIN(nnz, tid, nthreads);
+		index_t end 	= BLOCK_BEGIN(nnz, tid + 1, nthreads);
+
+		index_t count = 0;
+		for (index_t k = begin; k < end; k++) {
+			count += (!sum_duplicates || (k == 0) || !SAME_ENTRY(k, k - 1));
+		}
+		thread_offset[tid + 1] = count;
+
+		if (tid == 0) {
+			team_size = nthreads;
+		}
+	}
+
+	thread_offset[0] = 0;
+	for (int t = 0; t < team_size; t++) {
+		thread_offset[t + 1] += thread_offset[t];
+	}
+
+	//Step 3: allocate the CSR matrix and gather columns and values in sorted order
+	CSR->nr 	= COO->nr;
+	CSR->nc 	= COO->nc;
+	CSR->nnz 	= thread_offset[team_size];
+	reserve_CSR_matrix(CSR, 0);
+
+	#pragma omp parallel num_threads(team_size) if (nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int tid 		= get_thread_num();
+		index_t begin 	= BLOCK_BEGIN(nnz, tid, team_size);
+		index_t end 	= BLOCK_BEGIN(nnz, tid + 1, team_size);
+		index_t pos 	= thread_offset[tid] - 1;
+
+		for (index_t k = begin; k < end; k++) {
+
+			if (sum_duplicates && (k > 0) && SAME_ENTRY(k, k - 1)) {
+				//The run was started (and is summed) by the entry at its head
+				continue;
+			}
+
+			pos++;
+			double val = COO->a[order[k]];
+			if (sum_duplicates) {
+				for (index_t m = k + 1; (m < nnz) && SAME_ENTRY(m, k); m++) {
+					val += COO->a[order[m]];
+				}
+			}
+
+			CSR->ja[pos] 	= ENTRY_COL(k);
+			CSR->a[pos] 	= val;
+
+			//Row pointers: the first entry of a row closes all the preceding (possibly empty) rows
+			index_t row 	= ENTRY_ROW(k);
+			index_t prev 	= (k == 0) ? -1 : ENTRY_ROW(k - 1);
+			for (index_t r = prev + 1; r <= row; r++) {
+				CSR->ia[r] = pos;
+			}
+		}
+	}
+
+	//Rows after the last entry are empty
+	index_t last_row = (nnz > 0) ? ENTRY_ROW(nnz - 1) : -1;
+	for (index_t r = last_row + 1; r <= CSR->nr; r++) {
+		CSR->ia[r] = CSR->nnz;
+	}
+
+	#undef ENTRY_ROW
+	#undef ENTRY_COL
+	#undef SAME_ENTRY
+
+	free(key);
+	free(order);
+
+	INSTRUMENT_END(OP_UNSORTED_COO_TO_CSR, COO_BYTES(nnz) + COMPRESSED_BYTES(CSR->nr, CSR->nnz), nnz);
+}
+
+
 void convert_CSR_to_COO(SparseMatrix *CSR, SparseMatrix *COO) {
 
+	reset_matrix_storage(COO);
+	convert_CSR_to_COO_into(CSR, COO);
+}
+
+
+//This implementation assumes that the COO matrix is stored in row major ordering.
+void convert_CSR_to_COO_into(SparseMatrix *CSR, SparseMatrix *COO) {
+
+	INSTRUMENT_BEGIN();
+
 	//Step 1: allocate COO matrix
 	COO->nr 	= CSR->nr;
+	COO->nc 	= CSR->nc;
 	COO->nnz 	= CSR->nnz;
-	allocate_COO_matrix(COO);
+	reserve_COO_matrix(COO, 0);
 
 	//Step 2: populate the ja and a arrays of the CSR matrix
-	memcpy(COO->ja, CSR->ja, CSR->nnz * INT_SIZE);
+	memcpy(COO->ja, CSR->ja, CSR->nnz * INDEX_SIZE);
 	memcpy(COO->a, CSR->a, CSR->nnz * DOUBLE_SIZE);
 
-	//Step 3: populate the ia array of the CSR matrix
-	int i, j, k;
-	i = 0;
-	while (i < COO->nr) {
-		
-		j = CSR->ia[i];
-		while (j < COO->nnz) {
-			
-			for (k = 0; k < CSR->ia[i + 1] - j; k++) {
-				COO->ia[j] = i;
-			}
-			j++;
+	//Step 3: populate the ia array of the COO matrix
+	expand_row_pointers(CSR->ia, CSR->nr, COO->ia);
+	INSTRUMENT_END(OP_CSR_TO_COO, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + COO_BYTES(COO->nnz), CSR->nnz);
+}
+
+
+void convert_COO_to_CSR_move(SparseMatrix *COO, SparseMatrix *CSR) {
+
+	INSTRUMENT_BEGIN();
+
+	index_t nr 	= COO->nr;
+	index_t nnz = COO->nnz;
+
+	//Step 1: row pointers from the sorted row indices; they take O(nr) space, not O(nnz)
+	index_t *ptr = malloc(((size_t)nr + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(ptr);
+	compress_row_indices(COO->ia, nnz, nr, ptr);
+
+	//Step 2: the row pointers go into free space of the block if there is some, which leaves the
+	//space of the row indices to a later conversion back to COO, or else replace the row indices
+	if (COO->mem == NULL) {
+		free(COO->ia);
+		COO->ia = ptr;
+	}
+	else {
+		index_t *dest = find_row_array_room(COO, nnz, nnz, nr + 1, 0);
+		if (dest == NULL) {
+			dest = (nnz >= nr + 1) ? COO->ia : find_row_array_room(COO, nnz, nnz, nr + 1, 1);
 		}
-		i++;
+		memcpy(dest, ptr, ((size_t)nr + 1) * INDEX_SIZE);
+		COO->ia = dest;
+		free(ptr);
 	}
 
+	//Step 3: hand the storage over
+	SparseMatrix result = *COO;
+	reset_matrix_storage(COO);
+	*CSR = result;
+
+	INSTRUMENT_END(OP_COO_TO_CSR_MOVE, COO_BYTES(nnz) + ((uint64_t)nr + 1) * INDEX_SIZE, nnz);
+}
+
+
+void convert_CSR_to_COO_move(SparseMatrix *CSR, SparseMatrix *COO) {
+
+	INSTRUMENT_BEGIN();
+
+	index_t nr 	= CSR->nr;
+	index_t nnz = CSR->nnz;
+
+	//Step 1: room for the row indices, which are expanded from the row pointers still in place
+	index_t *rows;
+	if (CSR->mem == NULL) {
+		rows = malloc(((size_t)nnz + 1) * INDEX_SIZE);
+		IS_POINTER_VALID(rows);
+	}
+	else {
+		rows = find_row_array_room(CSR, nr + 1, nnz, nnz, 1);
+	}
+
+	//Step 2: expand the row pointers
+	expand_row_pointers(CSR->ia, nr, rows);
+	if (CSR->mem == NULL) {
+		free(CSR->ia);
+	}
+	CSR->ia = rows;
+
+	//Step 3: hand the storage over
+	SparseMatrix result = *CSR;
+	reset_matrix_storage(CSR);
+	*COO = result;
+
+	INSTRUMENT_END(OP_CSR_TO_COO_MOVE, ((uint64_t)nr + 1) * INDEX_SIZE + (uint64_t)nnz * INDEX_SIZE, nnz);
 }
 
 
 void convert_CSR_to_CSC(SparseMatrix *CSR, SparseMatrix *CSC) {
 
-	//Step 1: allocate CSC matrix
+	reset_matrix_storage(CSC);
+	convert_CSR_to_CSC_into(CSR, CSC);
+}
+
+
+void convert_CSR_to_CSC_into(SparseMatrix *CSR, SparseMatrix *CSC) {
+
+	INSTRUMENT_BEGIN();
+
+	//Step 1: allocate CSC matrix; only the column counts need to start at zero
 	CSC->nnz 	= CSR->nnz;
 	CSC->nr 	= CSR->nr;
-	allocate_CSC_matrix(CSC);
+	CSC->nc 	= CSR->nc;
+	reserve_CSC_matrix(CSC, 0);
+	memset(CSC->ja, 0, (CSC->nc + 1) * INDEX_SIZE);
 
-	int i, j, k, index;
+	index_t i, j, k, index;
 
 	//Step 2: populate column pointer array
-	for (i = 0; i < CSC->nr; i++) {
+	for (i = 0; i < CSR->nr; i++) {
 
 		for (j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
 			k 			= CSR->ja[j]  + 1;
@@ -203,12 +603,12 @@ void convert_CSR_to_CSC(SparseMatrix *CSR, SparseMatrix *CSC) {
 	}
 
 	CSC->ja[0] = 0;
-	for (i = 0; i < CSC->nr; i++) {
+	for (i = 0; i < CSC->nc; i++) {
 		CSC->ja[i + 1] += CSC->ja[i];
 	}
 
 	//Step 3: populate ia and a
-	for (i = 0; i < CSC->nr; i++) {
+	for (i = 0; i < CSR->nr; i++) {
 
 		for (j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
 			k 		= CSR->ja[j];
@@ -219,24 +619,36 @@ void convert_CSR_to_CSC(SparseMatrix *CSR, SparseMatrix *CSC) {
 		}
 	}
 
-	for (i = CSC->nr - 1; i >= 0; i--) {
+	for (i = CSC->nc - 1; i >= 0; i--) {
 		CSC->ja[i + 1] = CSC->ja[i];
 	}
 	CSC->ja[0] = 0;
+
+	INSTRUMENT_END(OP_CSR_TO_CSC, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + COMPRESSED_BYTES(CSC->nc, CSC->nnz), CSR->nnz);
 }
 
 void convert_CSC_to_CSR(SparseMatrix *CSC, SparseMatrix *CSR) {
 
-	
-	//Step 1: allocate CSR matrix
+	reset_matrix_storage(CSR);
+	convert_CSC_to_CSR_into(CSC, CSR);
+}
+
+
+void convert_CSC_to_CSR_into(SparseMatrix *CSC, SparseMatrix *CSR) {
+
+	INSTRUMENT_BEGIN();
+
+	//Step 1: allocate CSR matrix; only the row counts need to start at zero
 	CSR->nnz 	= CSC->nnz;
 	CSR->nr 	= CSC->nr;
-	allocate_CSR_matrix(CSR);
+	CSR->nc 	= CSC->nc;
+	reserve_CSR_matrix(CSR, 0);
+	memset(CSR->ia, 0, (CSR->nr + 1) * INDEX_SIZE);
 
-	int i, j, k, index;
+	index_t i, j, k, index;
 
 	//Step 2: populate row pointer array
-	for (i = 0; i < CSR->nr; i++) {
+	for (i = 0; i < CSC->nc; i++) {
 
 		for (j = CSC->ja[i]; j < CSC->ja[i + 1]; j++) {
 			k = CSC->ia[j]  + 1;
@@ -250,7 +662,7 @@ void convert_CSC_to_CSR(SparseMatrix *CSC, SparseMatrix *CSR) {
 	}
 
 	//Step 3: populate ia and a
-	for (i = 0; i < CSR->nr; i++) {
+	for (i = 0; i < CSC->nc; i++) {
 
 		for (j = CSC->ja[i]; j < CSC->ja[i + 1]; j++) {
 			k 		= CSC->ia[j];
@@ -266,16 +678,27 @@ void convert_CSC_to_CSR(SparseMatrix *CSC, SparseMatrix *CSR) {
 	}
 	CSR->ia[0] = 0;
 
+	INSTRUMENT_END(OP_CSC_TO_CSR, COMPRESSED_BYTES(CSC->nc, CSC->nnz) + COMPRESSED_BYTES(CSR->nr, CSR->nnz), CSC->nnz);
 }
 
 void transpose_CSR(const SparseMatrix *CSR, SparseMatrix *transpose) {
 
-	transpose->nr 	= CSR->nr;
+	reset_matrix_storage(transpose);
+	transpose_CSR_into(CSR, transpose);
+}
+
+
+void transpose_CSR_into(const SparseMatrix *CSR, SparseMatrix *transpose) {
+
+	INSTRUMENT_BEGIN();
+
+	transpose->nr 	= CSR->nc;
+	transpose->nc 	= CSR->nr;
 	transpose->nnz 	= CSR->nnz;
-	allocate_CSR_matrix(transpose);
+	reserve_CSR_matrix(transpose, 0);
 
-	int i, j, k;
-	int *row_count = calloc(transpose->nr, INT_SIZE);
+	index_t i, j, k;
+	index_t *row_count = calloc(transpose->nr, INDEX_SIZE);
 	IS_POINTER_VALID(row_count);
 
 	//Count the number of entries in each column of the input matrix
@@ -305,54 +728,360 @@ void transpose_CSR(const SparseMatrix *CSR, SparseMatrix *transpose) {
 	}
 
 	free(row_count);
+
+	INSTRUMENT_END(OP_TRANSPOSE_CSR, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + COMPRESSED_BYTES(transpose->nr, transpose->nnz), CSR->nnz);
 }
 
-int is_symmetric(SparseMatrix *CSR) {
+/**
+ * Parallel transposition of a compressed matrix with n_major compressed rows (or columns)
+ * and n_minor columns (or rows): CSR to CSC, CSC to CSR and the CSR transpose are all this operation.
+ * Each thread owns a contiguous block of major rows, balanced by nonzero count, and counts
+ * its entries per minor index in a private histogram. Offsetting every histogram by the
+ * entries of the previous threads makes each thread scatter into its own slice of every
+ * output row, so the output is sorted and identical to the serial version.*/
+static void transpose_compressed_parallel(index_t n_major, index_t n_minor, index_t nnz, const index_t *ptr, const index_t *idx, const double *val,
+										  index_t *t_ptr, index_t *t_idx, double *t_val) {
+
+	//The histograms take n_minor entries per thread: keep their total below nnz
+	int nthreads = get_max_threads();
+	if ((int64_t)nthreads * n_minor > nnz) {
+		nthreads = (n_minor > 0) ? (int)(nnz / n_minor) : 1;
+		nthreads = (nthreads < 1) ? 1 : nthreads;
+	}
+	if (nnz <= PARALLEL_NNZ_THRESHOLD) {
+		nthreads = 1;
+	}
 
-	//Loop over all the rows
-	for (int i = 0; i < CSR->nr; i++) {
+	index_t *hist = malloc((size_t)nthreads * n_minor * INDEX_SIZE);
+	IS_POINTER_VALID(hist);
+	index_t block_sum[nthreads + 1];
 
-		//Loop over the nonzero entries in each row
-		for (int j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+	//A single region, so that every step sees the same team, whatever size the runtime grants
+	#pragma omp parallel num_threads(nthreads)
+	{
+		int team_size 	= get_num_threads();
+		int tid 		= get_thread_num();
 
-			int col = CSR->ja[j];
-			double val = CSR->a[j];
+		index_t begin 	= nnz_balanced_row_split(ptr, n_major, tid, team_size);
+		index_t end 	= nnz_balanced_row_split(ptr, n_major, tid + 1, team_size);
+		index_t *count 	= hist + (size_t)tid * n_minor;
 
-			//Skip the diagonal entries
-			if (col != i) {
-				
-				int low 	= CSR->ia[col];
-				int high 	= CSR->ia[col + 1];
-				int key 	= binary_search_in_range(CSR->ja, low, high, INT_SIZE, compare_int, &i, 1);
-				if ((key != -1) && (CSR->a[key] == val)) {
-					continue;
-				}
+		//Step 1: per-thread histograms of the minor indices
+		memset(count, 0, n_minor * INDEX_SIZE);
+		for (index_t j = ptr[begin]; j < ptr[end]; j++) {
+			count[idx[j]]++;
+		}
 
-				//The matrix is not symmetric
-				else {
-					return 0;
-				}
+		#pragma omp barrier
+
+		//Step 2: every thread takes a block of output rows: offsets of each thread within them, and their lengths
+		index_t c_begin = BLOCK_BEGIN(n_minor, tid, team_size);
+		index_t c_end 	= BLOCK_BEGIN(n_minor, tid + 1, team_size);
+		index_t total 	= 0;
+		for (index_t c = c_begin; c < c_end; c++) {
+			index_t sum = 0;
+			for (int t = 0; t < team_size; t++) {
+				index_t n = hist[(size_t)t * n_minor + c];
+				hist[(size_t)t * n_minor + c] = sum;
+				sum += n;
+			}
+			t_ptr[c] 	= sum;
+			total 		+= sum;
+		}
+		block_sum[tid + 1] = total;
+
+		#pragma omp barrier
+
+		//Step 3: scan of the block sums
+		#pragma omp single
+		{
+			block_sum[0] = 0;
+			for (int t = 0; t < team_size; t++) {
+				block_sum[t + 1] += block_sum[t];
+			}
+			t_ptr[n_minor] = block_sum[team_size];
+		}
+
+		//Step 4: prefix sum of the output row lengths within the block, added to the thread offsets
+		index_t offset = block_sum[tid];
+		for (index_t c = c_begin; c < c_end; c++) {
+			index_t length = t_ptr[c];
+			t_ptr[c] = offset;
+			for (int t = 0; t < team_size; t++) {
+				hist[(size_t)t * n_minor + c] += offset;
+			}
+			offset += length;
+		}
+
+		#pragma omp barrier
+
+		//Step 5: scatter; each thread visits its rows in increasing order
+		for (index_t i = begin; i < end; i++) {
+			for (index_t j = ptr[i]; j < ptr[i + 1]; j++) {
+				index_t k 	= count[idx[j]]++;
+				t_idx[k] 	= i;
+				t_val[k] 	= val[j];
 			}
 		}
 	}
 
-	//The matrix is symmetric
-	return 1;
+	free(hist);
+}
+
+
+void convert_CSR_to_CSC_parallel(SparseMatrix *CSR, SparseMatrix *CSC) {
+
+	reset_matrix_storage(CSC);
+	convert_CSR_to_CSC_parallel_into(CSR, CSC);
+}
+
+
+void convert_CSR_to_CSC_parallel_into(SparseMatrix *CSR, SparseMatrix *CSC) {
+
+	INSTRUMENT_BEGIN();
+
+	CSC->nnz 	= CSR->nnz;
+	CSC->nr 	= CSR->nr;
+	CSC->nc 	= CSR->nc;
+	reserve_CSC_matrix(CSC, 0);
+
+	transpose_compressed_parallel(CSR->nr, CSR->nc, CSR->nnz, CSR->ia, CSR->ja, CSR->a, CSC->ja, CSC->ia, CSC->a);
+
+	INSTRUMENT_END(OP_CSR_TO_CSC_PARALLEL, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + COMPRESSED_BYTES(CSC->nc, CSC->nnz), CSR->nnz);
+}
+
+
+void convert_CSC_to_CSR_parallel(SparseMatrix *CSC, SparseMatrix *CSR) {
+
+	reset_matrix_storage(CSR);
+	convert_CSC_to_CSR_parallel_into(CSC, CSR);
+}
+
+
+void convert_CSC_to_CSR_parallel_into(SparseMatrix *CSC, SparseMatrix *CSR) {
+
+	INSTRUMENT_BEGIN();
+
+	CSR->nnz 	= CSC->nnz;
+	CSR->nr 	= CSC->nr;
+	CSR->nc 	= CSC->nc;
+	reserve_CSR_matrix(CSR, 0);
+
+	transpose_compressed_parallel(CSC->nc, CSC->nr, CSC->nnz, CSC->ja, CSC->ia, CSC->a, CSR->ia, CSR->ja, CSR->a);
+
+	INSTRUMENT_END(OP_CSC_TO_CSR_PARALLEL, COMPRESSED_BYTES(CSC->nc, CSC->nnz) + COMPRESSED_BYTES(CSR->nr, CSR->nnz), CSC->nnz);
+}
+
+
+void transpose_CSR_parallel(const SparseMatrix *CSR, SparseMatrix *transpose) {
+
+	reset_matrix_storage(transpose);
+	transpose_CSR_parallel_into(CSR, transpose);
+}
+
+
+void transpose_CSR_parallel_into(const SparseMatrix *CSR, SparseMatrix *transpose) {
+
+	INSTRUMENT_BEGIN();
+
+	transpose->nr 	= CSR->nc;
+	transpose->nc 	= CSR->nr;
+	transpose->nnz 	= CSR->nnz;
+	reserve_CSR_matrix(transpose, 0);
+
+	transpose_compressed_parallel(CSR->nr, CSR->nc, CSR->nnz, CSR->ia, CSR->ja, CSR->a, transpose->ia, transpose->ja, transpose->a);
+
+	INSTRUMENT_END(OP_TRANSPOSE_CSR_PARALLEL, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + COMPRESSED_BYTES(transpose->nr, transpose->nnz), CSR->nnz);
+}
+
+
+/**
+ * In-place transposition by cycle-following: every entry is first given its position in the
+ * transpose, which overwrites its column index; the rows are visited in order, so the entries
+ * of each column of the input keep increasing rows. The permutation is then applied cycle by
+ * cycle, the entry being moved carrying its value and its row, which is recovered from the
+ * untouched row pointers by binary search. Placed entries store their row as -(row + 1), which
+ * tells them apart from the positions still to be moved.*/
+int transpose_CSR_inplace(SparseMatrix *CSR) {
+
+	if (CSR->nr != CSR->nc) {
+		fprintf(stderr, "In-place transpose: the matrix is not square.\n");
+		return -1;
+	}
+
+	INSTRUMENT_BEGIN();
+
+	index_t n 		= CSR->nr;
+	index_t nnz 	= CSR->nnz;
+	index_t *ia 	= CSR->ia;
+	index_t *ja 	= CSR->ja;
+	double 	*a 		= CSR->a;
+
+	index_t *t_ptr 	= calloc((size_t)n + 1, INDEX_SIZE);
+	index_t *next 	= malloc(((size_t)n + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(t_ptr);
+	IS_POINTER_VALID(next);
+
+	//Step 1: row pointers of the transpose
+	for (index_t p = 0; p < nnz; p++) {
+		t_ptr[ja[p] + 1]++;
+	}
+	for (index_t i = 0; i < n; i++) {
+		t_ptr[i + 1] += t_ptr[i];
+	}
+
+	//Step 2: destination of every entry
+	memcpy(next, t_ptr, ((size_t)n + 1) * INDEX_SIZE);
+	for (index_t p = 0; p < nnz; p++) {
+		ja[p] = next[ja[p]]++;
+	}
+
+	#define ENTRY_ROW(p) 	((index_t)INDEX_TYPED(lower_bound)(ia, (size_t)n + 1, (p) + 1) - 1)
+
+	//Step 3: follow the cycles of the permutation
+	for (index_t start = 0; start < nnz; start++) {
+
+		if (ja[start] < 0) {
+			continue;
+		}
+
+		index_t dest 	= ja[start];
+		index_t row 	= ENTRY_ROW(start);
+		double 	val 	= a[start];
+
+		while (1) {
+			index_t next_dest 	= ja[dest];
+			index_t next_row 	= ENTRY_ROW(dest);
+			double 	next_val 	= a[dest];
+
+			ja[dest] 	= -(row + 1);
+			a[dest] 	= val;
+			if (dest == start) {
+				break;
+			}
+
+			dest 	= next_dest;
+			row 	= next_row;
+			val 	= next_val;
+		}
+	}
+
+	#undef ENTRY_ROW
+
+	//Step 4: unmark the rows and install the row pointers of the transpose
+	#pragma omp parallel for if (nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t p = 0; p < nnz; p++) {
+		ja[p] = -ja[p] - 1;
+	}
+	memcpy(ia, t_ptr, ((size_t)n + 1) * INDEX_SIZE);
+
+	free(t_ptr);
+	free(next);
+
+	INSTRUMENT_END(OP_TRANSPOSE_CSR_INPLACE, 2 * COMPRESSED_BYTES(n, nnz), nnz);
+	return 0;
+}
+
+
+/**
+ * The matrix is compared with its transpose, row by row. Since both have sorted columns,
+ * the rows match exactly when the matrix is symmetric, so each row is a linear merge
+ * instead of one binary search per entry. The rows are checked in parallel, and the
+ * threads stop as soon as one of them finds a mismatch.*/
+static int check_symmetry(SparseMatrix *CSR, int numerical, double rtol) {
+
+	INSTRUMENT_BEGIN();
+
+	if (CSR->nr != CSR->nc) {
+		return 0;
+	}
+
+	SparseMatrix T;
+	transpose_CSR_parallel(CSR, &T);
+
+	int symmetric = 1;
+
+	#pragma omp parallel for schedule(dynamic, 1024) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < CSR->nr; i++) {
+
+		int still_symmetric;
+		#pragma omp atomic read
+		still_symmetric = symmetric;
+		if (!still_symmetric) {
+			continue;
+		}
+
+		int match = (CSR->ia[i] == T.ia[i]) && (CSR->ia[i + 1] == T.ia[i + 1]);
+
+		for (index_t j = CSR->ia[i]; match && (j < CSR->ia[i + 1]); j++) {
+
+			if (CSR->ja[j] != T.ja[j]) {
+				match = 0;
+			}
+			else if (numerical) {
+				double diff 	= fabs(CSR->a[j] - T.a[j]);
+				double scale 	= fmax(fabs(CSR->a[j]), fabs(T.a[j]));
+				match = (diff <= rtol * scale);
+			}
+		}
+
+		if (!match) {
+			#pragma omp atomic write
+			symmetric = 0;
+		}
+	}
+
+	deallocate_sparse_matrix(&T);
+
+	INSTRUMENT_END(OP_CHECK_SYMMETRY, 2 * COMPRESSED_BYTES(CSR->nr, CSR->nnz), CSR->nnz);
+	return symmetric;
+}
+
+
+int is_structurally_symmetric(SparseMatrix *CSR) {
+
+	return check_symmetry(CSR, 0, 0.0);
+}
+
+
+int is_numerically_symmetric(SparseMatrix *CSR, double rtol) {
+
+	return check_symmetry(CSR, 1, rtol);
+}
+
+
+int is_symmetric(SparseMatrix *CSR) {
+
+	return check_symmetry(CSR, 1, 0.0);
 }
 
 
 void extract_upper_triangular(SparseMatrix *CSR, SparseMatrix *upper) {
 
+	INSTRUMENT_BEGIN();
+
 	upper->nr 	= CSR->nr;
-	upper->nnz 	= (CSR->nnz - CSR->nr) / 2 + CSR->nr;
+	upper->nc 	= CSR->nc;
+
+	//Count the entries to keep: the diagonal may be incomplete and the matrix rectangular,
+	//so the count cannot be derived from nnz and nr alone.
+	index_t count = 0;
+	for (index_t i = 0; i < CSR->nr; i++) {
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+			count += (CSR->ja[j] >= i);
+		}
+	}
+	upper->nnz = count;
 
-	allocate_CSR_matrix(upper); 
-	
-	int k = 0;
-	for (int i = 0; i < CSR->nr; i++) {
+	reset_matrix_storage(upper);
+	reserve_CSR_matrix(upper, 0);
+	upper->ia[0] = 0;
+
+	index_t k = 0;
+	for (index_t i = 0; i < CSR->nr; i++) {
 
-		int m = 0;
-		for (int j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+		index_t m = 0;
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
 
 			//Populate ja and a
 			if (CSR->ja[j] >= i) {
@@ -367,21 +1096,36 @@ void extract_upper_triangular(SparseMatrix *CSR, SparseMatrix *upper) {
 		upper->ia[i + 1] = m + upper->ia[i];
 	}
 
+	INSTRUMENT_END(OP_EXTRACT_TRIANGULAR, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + COMPRESSED_BYTES(upper->nr, upper->nnz), CSR->nnz);
 }
 
 
 void extract_lower_triangular(SparseMatrix *CSR, SparseMatrix *lower) {
 
+	INSTRUMENT_BEGIN();
+
 	lower->nr 	= CSR->nr;
-	lower->nnz 	= (CSR->nnz - CSR->nr) / 2 + CSR->nr;
+	lower->nc 	= CSR->nc;
+
+	//Count the entries to keep: the diagonal may be incomplete and the matrix rectangular,
+	//so the count cannot be derived from nnz and nr alone.
+	index_t count = 0;
+	for (index_t i = 0; i < CSR->nr; i++) {
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+			count += (CSR->ja[j] <= i);
+		}
+	}
+	lower->nnz = count;
 
-	allocate_CSR_matrix(lower); 
-	
-	int k = 0;
-	for (int i = 0; i < CSR->nr; i++) {
+	reset_matrix_storage(lower);
+	reserve_CSR_matrix(lower, 0);
+	lower->ia[0] = 0;
 
-		int m = 0;
-		for (int j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+	index_t k = 0;
+	for (index_t i = 0; i < CSR->nr; i++) {
+
+		index_t m = 0;
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
 
 			//Populate ja and a
 			if (CSR->ja[j] <= i) {
@@ -397,17 +1141,18 @@ void extract_lower_triangular(SparseMatrix *CSR, SparseMatrix *lower) {
 		lower->ia[i + 1] = m + lower->ia[i];
 	}
 
+	INSTRUMENT_END(OP_EXTRACT_TRIANGULAR, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + COMPRESSED_BYTES(lower->nr, lower->nnz), CSR->nnz);
 }
 
 void print_CSR_matrix(SparseMatrix *CSR) {
 
 	printf("CSR entries: \n");
-	for (int i = 0; i < CSR->nnz; i++) {
-		printf("ja[%d] = %d, a[%d] = %g\n", i, CSR->ja[i], i, CSR->a[i]);
+	for (index_t i = 0; i < CSR->nnz; i++) {
+		printf("ja[" INDEX_FMT "] = " INDEX_FMT ", a[" INDEX_FMT "] = %g\n", i, CSR->ja[i], i, CSR->a[i]);
 	}
 
-	for (int i = 0; i < CSR->nr + 1; i++) {
-		printf("ia [%d] = %d\n", i, CSR->ia[i]);
+	for (index_t i = 0; i < CSR->nr + 1; i++) {
+		printf("ia [" INDEX_FMT "] = " INDEX_FMT "\n", i, CSR->ia[i]);
 	}
 }
 
@@ -415,51 +1160,36 @@ void print_CSR_matrix(SparseMatrix *CSR) {
 void print_CSC_matrix(SparseMatrix *CSC) {
 
 	printf("CSC entries: \n");
-	for (int i = 0; i < CSC->nnz; i++) {
-		printf("ia[%d] = %d, a[%d] = %g\n", i, CSC->ia[i], i, CSC->a[i]);
+	for (index_t i = 0; i < CSC->nnz; i++) {
+		printf("ia[" INDEX_FMT "] = " INDEX_FMT ", a[" INDEX_FMT "] = %g\n", i, CSC->ia[i], i, CSC->a[i]);
 	}
 
-	for (int i = 0; i < CSC->nr + 1; i++) {
-		printf("ja [%d] = %d\n", i, CSC->ja[i]);
+	for (index_t i = 0; i < CSC->nc + 1; i++) {
+		printf("ja [" INDEX_FMT "] = " INDEX_FMT "\n", i, CSC->ja[i]);
 	}
 }
 
 /**
- * This .dat file is required by the Gnuplot script in order to visualize the matrix' 
- * sparsity pattern. The file will be found in build/ directory.*/
-void write_CSR_matrix_to_file(SparseMatrix *mat) {
-
-	FILE *mat_data = fopen("mat_data.dat", "w");
-	IS_POINTER_VALID(mat_data);
-
-	for (int i = 0; i < mat->nr; i++) {
-		for (int j = mat->ia[i]; j < mat->ia[i + 1]; j++) {
-			fprintf(mat_data, "%d \t %d \t %f\n", i, mat->ja[j], mat->a[j]);
-		}
-	}
-
-	fclose(mat_data);
-}
-
-
-/**
- * Plots the sparsity pattern of a sparse matrix stored in CSR format as a .png image,
- * which will be saved in build/ directory.
- * This function executes a Gnuplot script by invoking the system() library function.*/
+ * Plots the sparsity pattern of a sparse matrix stored in CSR format as a 600 x 600 .png image,
+ * 'sparse_matrix_plot.png' in the working directory (see render_sparsity_pattern).*/
 void plot_sparsity_pattern(SparseMatrix *mat) {
 
-	write_CSR_matrix_to_file(mat);
-	char command[256];
-	int n = mat->nr;
-	snprintf(command, sizeof(command), "gnuplot -e \"n=%d\" ../plot_sparse.p", n);
-    system(command);
-    printf("Plot saved as 'sparse_matrix_plot.png'\n");
+	if (render_sparsity_pattern(mat, 600, "sparse_matrix_plot.png") == 0) {
+		printf("Plot saved as 'sparse_matrix_plot.png'\n");
+	}
 }
 
 
 void deallocate_sparse_matrix(SparseMatrix *mat) {
-	
-	free(mat->ia);
-	free(mat->ja);
-	free(mat->a);
+
+	if (mat->mem != NULL) {
+		INSTRUMENT_RELEASE(mat->capacity);
+		free(mat->mem);
+	}
+	else {
+		free(mat->ia);
+		free(mat->ja);
+		free(mat->a);
+	}
+	reset_matrix_storage(mat);
 }
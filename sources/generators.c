@@ -0,0 +1,447 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "generators.h"
+
+
+//Writes row i into cols and vals, sorted by column, and returns its length
+typedef index_t (*RowGenerator)(const void *params, index_t i, index_t *cols, double *vals);
+
+//Upper bound of the length of row i, before merging duplicates
+typedef index_t (*RowBound)(const void *params, index_t i);
+
+
+//Per-thread row buffer, grown on demand
+typedef struct {
+	index_t 	capacity;
+	index_t 	*cols;
+	double 		*vals;
+} RowBuffer;
+
+
+static void reserve_row_buffer(RowBuffer *buf, index_t n) {
+
+	if (n <= buf->capacity) {
+		return;
+	}
+	buf->capacity 	= (n > 2 * buf->capacity) ? n : 2 * buf->capacity;
+	buf->cols 		= realloc(buf->cols, (size_t)buf->capacity * INDEX_SIZE);
+	buf->vals 		= realloc(buf->vals, (size_t)buf->capacity * DOUBLE_SIZE);
+	IS_POINTER_VALID(buf->cols);
+	IS_POINTER_VALID(buf->vals);
+}
+
+
+/**
+ * Two passes over the rows: count, allocate the CSR matrix at its exact size, then write.
+ * Each row is generated twice, which costs less than the memory traffic of a COO intermediate.*/
+static int generate_rows(index_t nr, index_t nc, const void *params, RowBound bound, RowGenerator row, SparseMatrix *CSR) {
+
+	index_t *row_nnz = malloc(((size_t)nr + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(row_nnz);
+
+	int64_t total = 0;
+
+	#pragma omp parallel reduction(+:total) if (nr > PARALLEL_NNZ_THRESHOLD)
+	{
+		RowBuffer buf = {0, NULL, NULL};
+
+		#pragma omp for schedule(dynamic, 1024)
+		for (index_t i = 0; i < nr; i++) {
+			reserve_row_buffer(&buf, bound(params, i));
+			row_nnz[i] 	= row(params, i, buf.cols, buf.vals);
+			total 		+= row_nnz[i];
+		}
+
+		free(buf.cols);
+		free(buf.vals);
+	}
+
+	if (total > INDEX_MAX) {
+		fprintf(stderr, "Generator: the matrix has too many entries for the index type.\n");
+		free(row_nnz);
+		return -1;
+	}
+
+	row_nnz[nr] = 0;
+	parallel_exclusive_scan(row_nnz, nr + 1);
+
+	CSR->nr 	= nr;
+	CSR->nc 	= nc;
+	CSR->nnz 	= (index_t)total;
+	reset_matrix_storage(CSR);
+	reserve_CSR_matrix(CSR, 0);
+	memcpy(CSR->ia, row_nnz, ((size_t)nr + 1) * INDEX_SIZE);
+	free(row_nnz);
+
+	#pragma omp parallel if (nr > PARALLEL_NNZ_THRESHOLD)
+	{
+		RowBuffer buf = {0, NULL, NULL};
+
+		#pragma omp for schedule(dynamic, 1024)
+		for (index_t i = 0; i < nr; i++) {
+			reserve_row_buffer(&buf, bound(params, i));
+			index_t len = row(params, i, buf.cols, buf.vals);
+			memcpy(CSR->ja + CSR->ia[i], buf.cols, (size_t)len * INDEX_SIZE);
+			memcpy(CSR->a + CSR->ia[i], buf.vals, (size_t)len * DOUBLE_SIZE);
+		}
+
+		free(buf.cols);
+		free(buf.vals);
+	}
+
+	return 0;
+}
+
+
+//Random stream of row i (splitmix64): the same for any number of threads
+static uint64_t row_stream(uint64_t seed, index_t i) {
+
+	return seed ^ ((uint64_t)i * 0xd1b54a32d192ed03ULL);
+}
+
+static uint64_t next_random(uint64_t *state) {
+
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+//Uniform in [0, 1)
+static double next_uniform(uint64_t *state) {
+
+	return (double)(next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+//Sorts a row and merges its duplicate columns, keeping the first value; returns the new length
+static index_t sort_and_merge(index_t *cols, double *vals, index_t len) {
+
+	sort_row_by_column(cols, vals, len);
+
+	index_t k = 0;
+	for (index_t j = 0; j < len; j++) {
+		if ((k == 0) || (cols[j] != cols[k - 1])) {
+			cols[k] = cols[j];
+			vals[k] = vals[j];
+			k++;
+		}
+	}
+	return k;
+}
+
+
+/* Stencils */
+
+typedef struct {
+	index_t 	nx, ny, nz;
+	int 		full;			//27-point (all 26 neighbours) instead of 7-point (face neighbours)
+	double 		diag;
+} Stencil;
+
+
+static index_t stencil_bound(const void *params, index_t i) {
+
+	(void)i;
+	return ((const Stencil *)params)->full ? 27 : 7;
+}
+
+
+//The neighbours are visited by increasing z, y, then x offset, i.e. by increasing column
+static index_t stencil_row(const void *params, index_t i, index_t *cols, double *vals) {
+
+	const Stencil *s = (const Stencil *)params;
+	index_t x = i % s->nx;
+	index_t y = (i / s->nx) % s->ny;
+	index_t z = i / ((index_t)s->nx * s->ny);
+	index_t len = 0;
+
+	for (int dz = -1; dz <= 1; dz++) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+
+				int manhattan = abs(dx) + abs(dy) + abs(dz);
+				if (!s->full && (manhattan > 1)) {
+					continue;
+				}
+				if ((x + dx < 0) || (x + dx >= s->nx) || (y + dy < 0) || (y + dy >= s->ny) || (z + dz < 0) || (z + dz >= s->nz)) {
+					continue;
+				}
+
+				cols[len] = i + dx + (index_t)dy * s->nx + (index_t)dz * s->nx * s->ny;
+				vals[len] = (manhattan == 0) ? s->diag : -1.0;
+				len++;
+			}
+		}
+	}
+	return len;
+}
+
+
+int generate_laplacian_2d(index_t nx, index_t ny, SparseMatrix *CSR) {
+
+	if ((nx <= 0) || (ny <= 0) || ((int64_t)nx * ny > INDEX_MAX)) {
+		return -1;
+	}
+
+	Stencil s = {nx, ny, 1, 0, 4.0};
+	return generate_rows(nx * ny, nx * ny, &s, stencil_bound, stencil_row, CSR);
+}
+
+
+int generate_laplacian_3d(index_t nx, index_t ny, index_t nz, int points, SparseMatrix *CSR) {
+
+	if ((nx <= 0) || (ny <= 0) || (nz <= 0) || ((points != 7) && (points != 27)) || ((int64_t)nx * ny * nz > INDEX_MAX)) {
+		return -1;
+	}
+
+	Stencil s = {nx, ny, nz, (points == 27), (double)(points - 1)};
+	return generate_rows(nx * ny * nz, nx * ny * nz, &s, stencil_bound, stencil_row, CSR);
+}
+
+
+/* Banded matrices */
+
+typedef struct {
+	index_t 	n, lower, upper;
+} Band;
+
+
+static index_t band_bound(const void *params, index_t i) {
+
+	(void)i;
+	const Band *b = (const Band *)params;
+	return b->lower + b->upper + 1;
+}
+
+
+static index_t band_row(const void *params, index_t i, index_t *cols, double *vals) {
+
+	const Band *b 	= (const Band *)params;
+	index_t first 	= (i > b->lower) ? i - b->lower : 0;
+	index_t last 	= (i < b->n - 1 - b->upper) ? i + b->upper : b->n - 1;
+	index_t len 	= 0;
+
+	for (index_t j = first; j <= last; j++) {
+		cols[len] = j;
+		vals[len] = (j == i) ? (double)(b->lower + b->upper + 1) : -1.0;
+		len++;
+	}
+	return len;
+}
+
+
+int generate_banded(index_t n, index_t lower, index_t upper, SparseMatrix *CSR) {
+
+	if ((n <= 0) || (lower < 0) || (upper < 0)) {
+		return -1;
+	}
+
+	lower = (lower < n) ? lower : n - 1;
+	upper = (upper < n) ? upper : n - 1;
+
+	Band b = {n, lower, upper};
+	return generate_rows(n, n, &b, band_bound, band_row, CSR);
+}
+
+
+/* Erdos-Renyi random matrices */
+
+typedef struct {
+	index_t 	nc;
+	double 		nnz_per_row;
+	uint64_t 	seed;
+} Uniform;
+
+
+static index_t uniform_bound(const void *params, index_t i) {
+
+	(void)i;
+	return (index_t)((const Uniform *)params)->nnz_per_row + 1;
+}
+
+
+static index_t uniform_row(const void *params, index_t i, index_t *cols, double *vals) {
+
+	const Uniform *u 	= (const Uniform *)params;
+	uint64_t state 		= row_stream(u->seed, i);
+
+	//Row length: the integer part, plus one with the probability given by the fractional part
+	index_t len = (index_t)u->nnz_per_row;
+	len += (next_uniform(&state) < u->nnz_per_row - len);
+
+	for (index_t k = 0; k < len; k++) {
+		cols[k] = (index_t)(next_random(&state) % (uint64_t)u->nc);
+		vals[k] = 1.0 - next_uniform(&state);
+	}
+	return sort_and_merge(cols, vals, len);
+}
+
+
+int generate_random_uniform(index_t nr, index_t nc, double nnz_per_row, uint64_t seed, SparseMatrix *CSR) {
+
+	if ((nr <= 0) || (nc <= 0) || (nnz_per_row < 0)) {
+		return -1;
+	}
+
+	Uniform u = {nc, (nnz_per_row < nc) ? nnz_per_row : (double)nc, seed};
+	return generate_rows(nr, nc, &u, uniform_bound, uniform_row, CSR);
+}
+
+
+/* R-MAT power-law matrices */
+
+typedef struct {
+	int 		scale;
+	double 		edges;				//expected number of entries
+	double 		top;				//probability of the upper half of the rows, a + b
+	double 		right_if_top;		//probability of the right half of the columns in the upper half, b / (a + b)
+	double 		right_if_bottom;	//same in the lower half, d / (c + d)
+	uint64_t 	seed;
+} Rmat;
+
+
+//Expected number of entries of row i: edges times the product of the quadrant probabilities of its bits
+static double rmat_expected_degree(const Rmat *r, index_t i) {
+
+	double p = r->edges;
+	for (int level = r->scale - 1; level >= 0; level--) {
+		p *= ((i >> level) & 1) ? (1.0 - r->top) : r->top;
+	}
+	return p;
+}
+
+
+static index_t rmat_bound(const void *params, index_t i) {
+
+	return (index_t)rmat_expected_degree((const Rmat *)params, i) + 1;
+}
+
+
+static index_t rmat_row(const void *params, index_t i, index_t *cols, double *vals) {
+
+	const Rmat *r 		= (const Rmat *)params;
+	uint64_t state 		= row_stream(r->seed, i);
+	double degree 		= rmat_expected_degree(r, i);
+
+	index_t len = (index_t)degree;
+	len += (next_uniform(&state) < degree - len);
+
+	for (index_t k = 0; k < len; k++) {
+
+		//Column bits, from the most significant, conditioned on the bits of the row
+		index_t col = 0;
+		for (int level = r->scale - 1; level >= 0; level--) {
+			double right = ((i >> level) & 1) ? r->right_if_bottom : r->right_if_top;
+			col = (col << 1) | (next_uniform(&state) < right);
+		}
+		cols[k] = col;
+		vals[k] = 1.0 - next_uniform(&state);
+	}
+	return sort_and_merge(cols, vals, len);
+}
+
+
+int generate_rmat(int scale, double edge_factor, double a, double b, double c, uint64_t seed, SparseMatrix *CSR) {
+
+	double d = 1.0 - a - b - c;
+	if ((scale < 1) || (scale > (int)(8 * INDEX_SIZE) - 2) || (edge_factor < 0) || (a <= 0) || (b < 0) || (c < 0) || (d <= 0)) {
+		return -1;
+	}
+
+	index_t n = (index_t)1 << scale;
+	Rmat r;
+	r.scale 			= scale;
+	r.edges 			= edge_factor * (double)n;
+	r.top 				= a + b;
+	r.right_if_top 		= b / (a + b);
+	r.right_if_bottom 	= d / (c + d);
+	r.seed 				= seed;
+
+	return generate_rows(n, n, &r, rmat_bound, rmat_row, CSR);
+}
+
+
+/* Block-structured FEM-like matrices */
+
+typedef struct {
+	index_t 	nx, ny;
+	int 		dof;
+} FemGrid;
+
+
+static index_t fem_bound(const void *params, index_t i) {
+
+	(void)i;
+	return 9 * ((const FemGrid *)params)->dof;
+}
+
+
+static index_t fem_row(const void *params, index_t i, index_t *cols, double *vals) {
+
+	const FemGrid *g 	= (const FemGrid *)params;
+	index_t node 		= i / g->dof;
+	index_t x 			= node % g->nx;
+	index_t y 			= node / g->nx;
+	index_t len 		= 0;
+
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+
+			if ((x + dx < 0) || (x + dx >= g->nx) || (y + dy < 0) || (y + dy >= g->ny)) {
+				continue;
+			}
+
+			index_t neighbour = node + dx + (index_t)dy * g->nx;
+			for (int p = 0; p < g->dof; p++) {
+				cols[len] = neighbour * g->dof + p;
+				vals[len] = (cols[len] == i) ? 9.0 * g->dof : -1.0;
+				len++;
+			}
+		}
+	}
+	return len;
+}
+
+
+int generate_fem_blocks_2d(index_t nx, index_t ny, int dof, SparseMatrix *CSR) {
+
+	if ((nx <= 0) || (ny <= 0) || (dof <= 0) || ((int64_t)nx * ny * dof > INDEX_MAX)) {
+		return -1;
+	}
+
+	FemGrid g = {nx, ny, dof};
+	return generate_rows(nx * ny * dof, nx * ny * dof, &g, fem_bound, fem_row, CSR);
+}
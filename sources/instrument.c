@@ -0,0 +1,230 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <time.h>
+
+#include "instrument.h"
+
+
+typedef struct {
+	uint64_t 	calls;
+	double 		seconds;
+	double 		max_seconds;
+	uint64_t 	bytes;
+	uint64_t 	nnz;
+} OperationCounters;
+
+
+/**
+ * Counters owned by one thread. Each block is pushed once onto a global lock-free list,
+ * the first time its thread records something, and stays there after the thread exits,
+ * so that its counts are still included in the totals.*/
+typedef struct ThreadCounters {
+	OperationCounters 		ops[OP_COUNT];
+	uint64_t 				allocations;
+	uint64_t 				allocated_bytes;
+	struct ThreadCounters 	*next;
+} ThreadCounters;
+
+
+#define INSTRUMENT_NAME_ENTRY(id, name) 	name,
+
+static const char *operation_names[OP_COUNT] = { INSTRUMENTED_OPERATIONS(INSTRUMENT_NAME_ENTRY) };
+
+static ThreadCounters 			*thread_list = NULL;
+static __thread ThreadCounters 	*local_counters = NULL;
+
+//The storage blocks may be allocated and freed by different threads, so these two are shared
+static size_t current_memory 	= 0;
+static size_t peak_memory 		= 0;
+
+
+static ThreadCounters *get_local_counters(void) {
+
+	if (local_counters == NULL) {
+		ThreadCounters *counters = calloc(1, sizeof(ThreadCounters));
+		IS_POINTER_VALID(counters);
+
+		counters->next = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE);
+		while (!__atomic_compare_exchange_n(&thread_list, &counters->next, counters, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+		}
+		local_counters = counters;
+	}
+	return local_counters;
+}
+
+
+int instrument_enabled(void) {
+
+#ifdef SPARSE_INSTRUMENT
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+
+double instrument_clock(void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+
+void instrument_record(InstrumentedOperation op, double seconds, uint64_t bytes, uint64_t nnz) {
+
+	OperationCounters *counters = &get_local_counters()->ops[op];
+
+	counters->calls++;
+	counters->seconds 	+= seconds;
+	counters->bytes 	+= bytes;
+	counters->nnz 		+= nnz;
+	if (seconds > counters->max_seconds) {
+		counters->max_seconds = seconds;
+	}
+}
+
+
+void instrument_allocation(size_t size) {
+
+	ThreadCounters *counters = get_local_counters();
+	counters->allocations++;
+	counters->allocated_bytes += size;
+
+	size_t current 	= __atomic_add_fetch(&current_memory, size, __ATOMIC_RELAXED);
+	size_t peak 	= __atomic_load_n(&peak_memory, __ATOMIC_RELAXED);
+	while ((current > peak) && !__atomic_compare_exchange_n(&peak_memory, &peak, current, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+
+void instrument_release(size_t size) {
+
+	__atomic_sub_fetch(&current_memory, size, __ATOMIC_RELAXED);
+}
+
+
+void instrument_get_operation(InstrumentedOperation op, OperationStats *stats) {
+
+	memset(stats, 0, sizeof(OperationStats));
+	stats->name = operation_names[op];
+
+	for (ThreadCounters *t = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE); t != NULL; t = t->next) {
+		const OperationCounters *counters = &t->ops[op];
+		stats->calls 	+= counters->calls;
+		stats->seconds 	+= counters->seconds;
+		stats->bytes 	+= counters->bytes;
+		stats->nnz 		+= counters->nnz;
+		if (counters->max_seconds > stats->max_seconds) {
+			stats->max_seconds = counters->max_seconds;
+		}
+	}
+}
+
+
+void instrument_get_memory(MemoryStats *stats) {
+
+	memset(stats, 0, sizeof(MemoryStats));
+
+	for (ThreadCounters *t = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE); t != NULL; t = t->next) {
+		stats->allocations 		+= t->allocations;
+		stats->allocated_bytes 	+= t->allocated_bytes;
+	}
+	stats->current_bytes 	= __atomic_load_n(&current_memory, __ATOMIC_RELAXED);
+	stats->peak_bytes 		= __atomic_load_n(&peak_memory, __ATOMIC_RELAXED);
+}
+
+
+void instrument_reset(void) {
+
+	for (ThreadCounters *t = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE); t != NULL; t = t->next) {
+		memset(t->ops, 0, sizeof(t->ops));
+		t->allocations 		= 0;
+		t->allocated_bytes 	= 0;
+	}
+	__atomic_store_n(&peak_memory, __atomic_load_n(&current_memory, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+
+void instrument_dump(FILE *out) {
+
+	if (!instrument_enabled()) {
+		fprintf(out, "Instrumentation disabled (rebuild with -DSPARSE_INSTRUMENT=ON)\n");
+		return;
+	}
+
+	fprintf(out, "%-28s %10s %12s %12s %12s %10s %14s\n", "operation", "calls", "total (ms)", "mean (ms)", "max (ms)", "GB/s", "nnz");
+
+	for (int op = 0; op < OP_COUNT; op++) {
+		OperationStats stats;
+		instrument_get_operation((InstrumentedOperation)op, &stats);
+		if (stats.calls == 0) {
+			continue;
+		}
+		double bandwidth = (stats.seconds > 0.0) ? 1e-9 * (double)stats.bytes / stats.seconds : 0.0;
+		fprintf(out, "%-28s %10" PRIu64 " %12.3f %12.3f %12.3f %10.2f %14" PRIu64 "\n", stats.name, stats.calls,
+				1e3 * stats.seconds, 1e3 * stats.seconds / (double)stats.calls, 1e3 * stats.max_seconds, bandwidth, stats.nnz);
+	}
+
+	MemoryStats memory;
+	instrument_get_memory(&memory);
+	fprintf(out, "Matrix storage: %" PRIu64 " allocations, %" PRIu64 " bytes allocated, %zu bytes in use, %zu bytes peak\n",
+			memory.allocations, memory.allocated_bytes, memory.current_bytes, memory.peak_bytes);
+}
+
+
+void instrument_dump_json(FILE *out) {
+
+	fprintf(out, "{\n  \"enabled\": %s,\n  \"operations\": [", instrument_enabled() ? "true" : "false");
+
+	int first = 1;
+	for (int op = 0; op < OP_COUNT; op++) {
+		OperationStats stats;
+		instrument_get_operation((InstrumentedOperation)op, &stats);
+		if (stats.calls == 0) {
+			continue;
+		}
+		fprintf(out, "%s\n    {\"name\": \"%s\", \"calls\": %" PRIu64 ", \"seconds\": %.9g, \"max_seconds\": %.9g, "
+				"\"bytes\": %" PRIu64 ", \"nnz\": %" PRIu64 "}", first ? "" : ",", stats.name, stats.calls,
+				stats.seconds, stats.max_seconds, stats.bytes, stats.nnz);
+		first = 0;
+	}
+
+	MemoryStats memory;
+	instrument_get_memory(&memory);
+	fprintf(out, "%s],\n  \"memory\": {\"allocations\": %" PRIu64 ", \"allocated_bytes\": %" PRIu64 ", "
+			"\"current_bytes\": %zu, \"peak_bytes\": %zu}\n}\n", first ? "" : "\n  ",
+			memory.allocations, memory.allocated_bytes, memory.current_bytes, memory.peak_bytes);
+}
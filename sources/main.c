@@ -32,36 +32,49 @@
  */
 
 #include "formats.h"
+#include "matrix_io.h"
+#include "reorder.h"
 
 /**
  * To check for memory issues, execute the following command:
  * valgrind --leak-check=full --track-origins=yes --show-leak-kinds=all --log-file="log.txt" ./bin/main
+ *
+ * A matrix can also be loaded from a Matrix Market file: ./bin/main matrix.mtx
  */
 
 int main(int argc, char const *argv[]) {
 
-	int nr 	= 5;
-	int nnz = 15;
-	
 	SparseMatrix CSR;
-	CSR.nr = nr;
-	CSR.nnz = nnz;
-	allocate_CSR_matrix(&CSR);
-
-	int ja[] 	= {0, 2, 4, 1, 3, 0, 2, 4, 1, 3, 4, 0, 2, 3, 4};
- 	double a[] 	= {1, -4, 3, 8, 2, 4, 7, 4, 2, 9, 5, 3, 4, 5, 6};
-	int ia[] 	= {0, 3, 5, 8, 11, 15};
 
-	memcpy(CSR.ia, ia, (nr + 1) * INT_SIZE);
-	memcpy(CSR.ja, ja, (nnz) * INT_SIZE);
-	memcpy(CSR.a, a, (nnz) * DOUBLE_SIZE);
+	if (argc > 1) {
+		if (read_matrix_market_CSR(argv[1], &CSR) != 0) {
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+		index_t nr 	= 5;
+		index_t nnz = 15;
+
+		CSR.nr = nr;
+		CSR.nc = nr;
+		CSR.nnz = nnz;
+		allocate_CSR_matrix(&CSR);
+
+		index_t ja[] 	= {0, 2, 4, 1, 3, 0, 2, 4, 1, 3, 4, 0, 2, 3, 4};
+	 	double a[] 	= {1, -4, 3, 8, 2, 4, 7, 4, 2, 9, 5, 3, 4, 5, 6};
+		index_t ia[] 	= {0, 3, 5, 8, 11, 15};
+
+		memcpy(CSR.ia, ia, (nr + 1) * INDEX_SIZE);
+		memcpy(CSR.ja, ja, (nnz) * INDEX_SIZE);
+		memcpy(CSR.a, a, (nnz) * DOUBLE_SIZE);
+	}
 
-	int *nzr = calloc(nr, INT_SIZE);
+	index_t *nzr = calloc(CSR.nr, INDEX_SIZE);
 	count_nonzeros_per_row_CSR(&CSR, nzr);
 
 	printf("Number of nonzero elements per row: \n");
-	for (int i = 0; i < CSR.nr; i++) {
-		printf("%d\n", nzr[i]);
+	for (index_t i = 0; i < CSR.nr; i++) {
+		printf(INDEX_FMT "\n", nzr[i]);
 	}
 	
 	plot_sparsity_pattern(&CSR);
@@ -95,6 +108,22 @@ int main(int argc, char const *argv[]) {
 	transpose_CSR(&CSR, &trans);
 	print_CSR_matrix(&trans);
 
+	printf("\n");
+	printf("Reverse Cuthill-McKee reordering: \n");
+
+	if (CSR.nr == CSR.nc) {
+		index_t *perm = malloc(CSR.nr * INDEX_SIZE);
+		IS_POINTER_VALID(perm);
+		compute_RCM_ordering(&CSR, perm);
+
+		SparseMatrix RCM;
+		permute_CSR(perm, &CSR, perm, &RCM);
+		printf("bandwidth: " INDEX_FMT " -> " INDEX_FMT "\n", matrix_bandwidth(&CSR), matrix_bandwidth(&RCM));
+		printf("profile: %" PRId64 " -> %" PRId64 "\n", matrix_profile(&CSR), matrix_profile(&RCM));
+
+		free(perm);
+		deallocate_sparse_matrix(&RCM);
+	}
 
 	free(nzr);
 	deallocate_sparse_matrix(&CSR);
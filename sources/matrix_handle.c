@@ -0,0 +1,247 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "matrix_handle.h"
+
+
+void init_matrix_handle(MatrixHandle *handle, SparseMatrix *CSR, size_t budget) {
+
+	memset(handle, 0, sizeof(MatrixHandle));
+
+	handle->CSR 			= *CSR;
+	handle->version 		= 1;
+	handle->pattern_version = 1;
+	handle->budget 			= budget;
+
+	for (int v = 0; v < VIEW_COUNT; v++) {
+		reset_matrix_storage(&handle->views[v].mat);
+	}
+
+	//The caller's copy no longer owns the arrays
+	reset_matrix_storage(CSR);
+}
+
+
+/**
+ * Upper bound on the size of a derived form, used to make room before it is built.
+ * The triangles are bounded by the whole matrix.*/
+static size_t view_bytes_estimate(const SparseMatrix *CSR, MatrixView view) {
+
+	size_t n 	= (view == VIEW_CSC || view == VIEW_TRANSPOSE) ? (size_t)CSR->nc : (size_t)CSR->nr;
+	size_t ia 	= (view == VIEW_COO) ? (size_t)CSR->nnz : n + 1;
+
+	return ALIGN_UP(ia * INDEX_SIZE, MEMORY_ALIGNMENT) + ALIGN_UP((size_t)CSR->nnz * INDEX_SIZE, MEMORY_ALIGNMENT) +
+		   ALIGN_UP((size_t)CSR->nnz * DOUBLE_SIZE, MEMORY_ALIGNMENT);
+}
+
+
+static void update_cached_bytes(MatrixHandle *handle) {
+
+	handle->cached_bytes = 0;
+	for (int v = 0; v < VIEW_COUNT; v++) {
+		if (handle->views[v].mat.mem != NULL) {
+			handle->cached_bytes += handle->views[v].mat.capacity;
+		}
+	}
+}
+
+
+static void free_view(MatrixHandle *handle, int v) {
+
+	deallocate_sparse_matrix(&handle->views[v].mat);
+	handle->views[v].version = 0;
+	update_cached_bytes(handle);
+}
+
+
+/**
+ * Frees derived forms other than keep until needed more bytes fit in the budget.
+ * The forms that are out of date go first, then the least recently requested ones.*/
+static void evict_views(MatrixHandle *handle, size_t needed, MatrixView keep) {
+
+	while ((handle->budget > 0) && (handle->cached_bytes + needed > handle->budget)) {
+
+		int victim = -1;
+		for (int v = 0; v < VIEW_COUNT; v++) {
+
+			const CachedView *cached = &handle->views[v];
+			if ((v == (int)keep) || (cached->mat.mem == NULL)) {
+				continue;
+			}
+			if (victim < 0) {
+				victim = v;
+				continue;
+			}
+
+			int stale 			= (cached->version != handle->version);
+			int victim_stale 	= (handle->views[victim].version != handle->version);
+			if ((stale > victim_stale) || ((stale == victim_stale) && (cached->last_use < handle->views[victim].last_use))) {
+				victim = v;
+			}
+		}
+
+		if (victim < 0) {
+			break;
+		}
+		free_view(handle, victim);
+	}
+}
+
+
+static void build_view(MatrixHandle *handle, MatrixView view) {
+
+	SparseMatrix *out = &handle->views[view].mat;
+
+	switch (view) {
+		case VIEW_CSC:
+			convert_CSR_to_CSC_parallel_into(&handle->CSR, out);
+			break;
+		case VIEW_TRANSPOSE:
+			transpose_CSR_parallel_into(&handle->CSR, out);
+			break;
+		case VIEW_COO:
+			convert_CSR_to_COO_into(&handle->CSR, out);
+			break;
+		//The triangle extraction allocates a new block
+		case VIEW_LOWER:
+			deallocate_sparse_matrix(out);
+			extract_lower_triangular(&handle->CSR, out);
+			break;
+		case VIEW_UPPER:
+			deallocate_sparse_matrix(out);
+			extract_upper_triangular(&handle->CSR, out);
+			break;
+		default:
+			break;
+	}
+}
+
+
+const SparseMatrix *get_matrix_view(MatrixHandle *handle, MatrixView view) {
+
+	if (((int)view < 0) || (view >= VIEW_COUNT)) {
+		fprintf(stderr, "Matrix handle: invalid view %d.\n", (int)view);
+		return NULL;
+	}
+
+	CachedView *cached 	= &handle->views[view];
+	cached->last_use 	= ++handle->clock;
+
+	if (cached->version != handle->version) {
+
+		//Step 1: make room, counting the block of an out-of-date form as reusable
+		size_t estimate = view_bytes_estimate(&handle->CSR, view);
+		size_t reused 	= (cached->mat.mem != NULL) ? cached->mat.capacity : 0;
+		evict_views(handle, (estimate > reused) ? estimate - reused : 0, view);
+
+		//Step 2: build the form, then settle the budget with its actual size
+		build_view(handle, view);
+		cached->version = handle->version;
+		update_cached_bytes(handle);
+		evict_views(handle, 0, view);
+	}
+
+	return &cached->mat;
+}
+
+
+int handle_is_structurally_symmetric(MatrixHandle *handle) {
+
+	CachedFlag *flag = &handle->structurally_symmetric;
+
+	if (flag->version != handle->pattern_version) {
+		flag->value 	= is_structurally_symmetric(&handle->CSR);
+		flag->version 	= handle->pattern_version;
+	}
+	return flag->value;
+}
+
+
+int handle_is_symmetric(MatrixHandle *handle) {
+
+	CachedFlag *flag = &handle->symmetric;
+
+	if (flag->version != handle->version) {
+
+		//A known asymmetric pattern settles the question without a check
+		if ((handle->structurally_symmetric.version == handle->pattern_version) && !handle->structurally_symmetric.value) {
+			flag->value = 0;
+		}
+		else {
+			flag->value = is_symmetric(&handle->CSR);
+		}
+		flag->version = handle->version;
+
+		if (flag->value) {
+			handle->structurally_symmetric.value 	= 1;
+			handle->structurally_symmetric.version 	= handle->pattern_version;
+		}
+	}
+	return flag->value;
+}
+
+
+void mark_values_changed(MatrixHandle *handle) {
+
+	handle->version++;
+}
+
+
+void mark_pattern_changed(MatrixHandle *handle) {
+
+	handle->version++;
+	handle->pattern_version++;
+}
+
+
+void set_handle_memory_budget(MatrixHandle *handle, size_t budget) {
+
+	handle->budget = budget;
+	evict_views(handle, 0, VIEW_COUNT);
+}
+
+
+void clear_matrix_views(MatrixHandle *handle) {
+
+	for (int v = 0; v < VIEW_COUNT; v++) {
+		free_view(handle, v);
+	}
+}
+
+
+void deallocate_matrix_handle(MatrixHandle *handle) {
+
+	clear_matrix_views(handle);
+	deallocate_sparse_matrix(&handle->CSR);
+}
@@ -0,0 +1,747 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "matrix_io.h"
+#include "instrument.h"
+
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+typedef enum { MM_REAL, MM_INTEGER, MM_PATTERN } MMField;
+
+typedef enum { MM_GENERAL, MM_SYMMETRIC, MM_SKEW_SYMMETRIC } MMSymmetry;
+
+
+//Header information of a Matrix Market file
+typedef struct {
+	MMField 	field;
+	MMSymmetry 	symmetry;
+	int64_t 	nrows;
+	int64_t 	ncols;
+	int64_t 	entries;		//number of entries stored in the file
+	size_t 		data_begin;		//offset of the first entry line
+} MMHeader;
+
+
+static int is_blank(char c) {
+
+	return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+
+/**
+ * Copies the line starting at offset into buffer, and returns the offset of the next line.*/
+static size_t read_line(const char *data, size_t size, size_t offset, char *buffer, size_t buffer_size) {
+
+	size_t n = 0;
+	while ((offset < size) && (data[offset] != '\n')) {
+		if (n < buffer_size - 1) {
+			buffer[n++] = data[offset];
+		}
+		offset++;
+	}
+	buffer[n] = '\0';
+	return (offset < size) ? offset + 1 : size;
+}
+
+
+static int parse_header(const char *data, size_t size, MMHeader *header) {
+
+	char line[1024], object[64], format[64], field[64], symmetry[64];
+
+	size_t offset = read_line(data, size, 0, line, sizeof(line));
+	if (sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s", object, format, field, symmetry) != 4) {
+		fprintf(stderr, "%s", "Invalid Matrix Market banner.\n");
+		return -1;
+	}
+
+	if ((strcasecmp(object, "matrix") != 0) || (strcasecmp(format, "coordinate") != 0)) {
+		fprintf(stderr, "%s", "Only Matrix Market coordinate matrices are supported.\n");
+		return -1;
+	}
+
+	if (strcasecmp(field, "real") == 0) {
+		header->field = MM_REAL;
+	}
+	else if (strcasecmp(field, "integer") == 0) {
+		header->field = MM_INTEGER;
+	}
+	else if (strcasecmp(field, "pattern") == 0) {
+		header->field = MM_PATTERN;
+	}
+	else {
+		fprintf(stderr, "Unsupported Matrix Market field '%s'.\n", field);
+		return -1;
+	}
+
+	if (strcasecmp(symmetry, "general") == 0) {
+		header->symmetry = MM_GENERAL;
+	}
+	else if ((strcasecmp(symmetry, "symmetric") == 0) || (strcasecmp(symmetry, "hermitian") == 0)) {
+		//For real-valued matrices, Hermitian and symmetric are the same thing
+		header->symmetry = MM_SYMMETRIC;
+	}
+	else if (strcasecmp(symmetry, "skew-symmetric") == 0) {
+		header->symmetry = MM_SKEW_SYMMETRIC;
+	}
+	else {
+		fprintf(stderr, "Unsupported Matrix Market symmetry '%s'.\n", symmetry);
+		return -1;
+	}
+
+	//Skip the comment lines, then read the size line
+	do {
+		if (offset >= size) {
+			fprintf(stderr, "%s", "Missing Matrix Market size line.\n");
+			return -1;
+		}
+		offset = read_line(data, size, offset, line, sizeof(line));
+	} while ((line[0] == '%') || (strspn(line, " \t\r") == strlen(line)));
+
+	if (sscanf(line, "%" SCNd64 " %" SCNd64 " %" SCNd64, &header->nrows, &header->ncols, &header->entries) != 3) {
+		fprintf(stderr, "%s", "Invalid Matrix Market size line.\n");
+		return -1;
+	}
+
+	header->data_begin = offset;
+	return 0;
+}
+
+
+static const char *parse_index(const char *p, const char *end, int64_t *value) {
+
+	while ((p < end) && is_blank(*p)) {
+		p++;
+	}
+
+	if ((p == end) || (*p < '0') || (*p > '9')) {
+		return NULL;
+	}
+
+	int64_t v = 0;
+	while ((p < end) && (*p >= '0') && (*p <= '9')) {
+		v = 10 * v + (*p - '0');
+		p++;
+	}
+
+	*value = v;
+	return p;
+}
+
+
+/**
+ * Hand-rolled floating-point parser.
+ * Numbers with at most 19 significant digits whose mantissa and power of ten are both
+ * exactly representable are converted exactly with a single multiplication or division;
+ * the remaining (rare) cases fall back to strtod().*/
+static const char *parse_value(const char *p, const char *end, double *value) {
+
+	static const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	while ((p < end) && is_blank(*p)) {
+		p++;
+	}
+
+	const char *start = p;
+	int 		negative = 0;
+
+	if ((p < end) && ((*p == '-') || (*p == '+'))) {
+		negative = (*p == '-');
+		p++;
+	}
+
+	unsigned long long 	mantissa 	= 0;
+	int 				digits 		= 0;
+	int 				exponent 	= 0;
+	int 				any_digit 	= 0;
+
+	for ( ; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+		any_digit = 1;
+		if ((mantissa == 0) && (*p == '0')) {
+			continue;
+		}
+		if (digits < 19) {
+			mantissa = 10 * mantissa + (*p - '0');
+			digits++;
+		}
+		else {
+			exponent++;
+		}
+	}
+
+	if ((p < end) && (*p == '.')) {
+		p++;
+		for ( ; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+			any_digit = 1;
+			if ((mantissa == 0) && (*p == '0')) {
+				exponent--;
+				continue;
+			}
+			if (digits < 19) {
+				mantissa = 10 * mantissa + (*p - '0');
+				digits++;
+				exponent--;
+			}
+		}
+	}
+
+	if (!any_digit) {
+		return NULL;
+	}
+
+	if ((p < end) && ((*p == 'e') || (*p == 'E') || (*p == 'd') || (*p == 'D'))) {
+		p++;
+		int exp_negative = 0;
+		if ((p < end) && ((*p == '-') || (*p == '+'))) {
+			exp_negative = (*p == '-');
+			p++;
+		}
+		if ((p == end) || (*p < '0') || (*p > '9')) {
+			return NULL;
+		}
+		int e = 0;
+		for ( ; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+			if (e < 100000) {
+				e = 10 * e + (*p - '0');
+			}
+		}
+		exponent += exp_negative ? -e : e;
+	}
+
+	if ((mantissa < (1ULL << 53)) && (exponent >= -22) && (exponent <= 22)) {
+		double v = (double)mantissa;
+		v = (exponent < 0) ? v / powers_of_ten[-exponent] : v * powers_of_ten[exponent];
+		*value = negative ? -v : v;
+		return p;
+	}
+
+	//Slow path: the mapped file is not null-terminated, so the token is copied first
+	char token[128];
+	size_t len = p - start;
+	if (len >= sizeof(token)) {
+		len = sizeof(token) - 1;
+	}
+	memcpy(token, start, len);
+	token[len] = '\0';
+	for (size_t i = 0; i < len; i++) {
+		if ((token[i] == 'd') || (token[i] == 'D')) {
+			token[i] = 'e';
+		}
+	}
+	*value = strtod(token, NULL);
+	return p;
+}
+
+
+/**
+ * First offset of the chunk processed by thread part: chunk boundaries are moved
+ * forward to the beginning of the next line.*/
+static size_t chunk_begin(const char *data, size_t size, size_t data_begin, int part, int nparts) {
+
+	if (part == 0) {
+		return data_begin;
+	}
+	if (part == nparts) {
+		return size;
+	}
+
+	size_t offset = data_begin + (size - data_begin) * part / nparts;
+	while ((offset < size) && (data[offset - 1] != '\n')) {
+		offset++;
+	}
+	return offset;
+}
+
+
+/**
+ * Parses the entries in [begin, end).
+ * In the counting pass, the entries of each row are counted in row_count.
+ * In the filling pass, row_count holds the next free position of each row.
+ * @return	the number of entries read from the file, or -1 on a parse error.*/
+static int64_t parse_chunk(const char *begin, const char *end, const MMHeader *header, int counting, index_t *row_count, SparseMatrix *CSR) {
+
+	const char 	*p 		= begin;
+	int64_t 	entries = 0;
+
+	while (p < end) {
+
+		//Skip blank lines and comments
+		const char *line = p;
+		while ((line < end) && is_blank(*line)) {
+			line++;
+		}
+		if ((line == end) || (*line == '\n') || (*line == '%')) {
+			while ((p < end) && (*p != '\n')) {
+				p++;
+			}
+			p++;
+			continue;
+		}
+
+		int64_t row, col;
+		double 	val = 1.0;
+
+		p = parse_index(p, end, &row);
+		if (p != NULL) {
+			p = parse_index(p, end, &col);
+		}
+		if ((p != NULL) && (header->field != MM_PATTERN)) {
+			p = parse_value(p, end, &val);
+		}
+		if ((p == NULL) || (row < 1) || (row > header->nrows) || (col < 1) || (col > header->ncols)) {
+			return -1;
+		}
+
+		//Skip the rest of the line
+		while ((p < end) && (*p != '\n')) {
+			p++;
+		}
+		p++;
+
+		entries++;
+		row--;
+		col--;
+
+		int mirror = (header->symmetry != MM_GENERAL) && (row != col);
+
+		if (counting) {
+			#pragma omp atomic
+			row_count[row]++;
+
+			if (mirror) {
+				#pragma omp atomic
+				row_count[col]++;
+			}
+		}
+		else {
+			index_t k;
+			#pragma omp atomic capture
+			k = row_count[row]++;
+
+			CSR->ja[k] 	= col;
+			CSR->a[k] 	= val;
+
+			if (mirror) {
+				#pragma omp atomic capture
+				k = row_count[col]++;
+
+				CSR->ja[k] 	= row;
+				CSR->a[k] 	= (header->symmetry == MM_SKEW_SYMMETRIC) ? -val : val;
+			}
+		}
+	}
+
+	return entries;
+}
+
+
+int read_matrix_market_CSR(const char *filename, SparseMatrix *CSR) {
+
+	INSTRUMENT_BEGIN();
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot open '%s'.\n", filename);
+		return -1;
+	}
+
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+		fprintf(stderr, "Cannot read '%s'.\n", filename);
+		close(fd);
+		return -1;
+	}
+
+	size_t size = st.st_size;
+	const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Cannot map '%s'.\n", filename);
+		return -1;
+	}
+	madvise((void *)data, size, MADV_SEQUENTIAL);
+
+	MMHeader header;
+	if (parse_header(data, size, &header) != 0) {
+		munmap((void *)data, size);
+		return -1;
+	}
+
+	//Symmetric storage doubles the off-diagonal entries, hence the factor 2
+	if ((header.nrows > INDEX_MAX - 1) || (header.ncols > INDEX_MAX - 1) || (header.entries > INDEX_MAX / 2)) {
+#ifdef SPARSE_INDEX_64
+		fprintf(stderr, "'%s' is too large for 64-bit indices: at most " INDEX_FMT " rows and columns, and " INDEX_FMT " entries.\n",
+				filename, INDEX_MAX - 1, INDEX_MAX / 2);
+#else
+		fprintf(stderr, "'%s' is too large for 32-bit indices, rebuild with SPARSE_INDEX_64.\n", filename);
+#endif
+		munmap((void *)data, size);
+		return -1;
+	}
+
+	if ((header.symmetry != MM_GENERAL) && (header.nrows != header.ncols)) {
+		fprintf(stderr, "'%s' is declared symmetric but is not square.\n", filename);
+		munmap((void *)data, size);
+		return -1;
+	}
+
+	CSR->nr = header.nrows;
+	CSR->nc = header.ncols;
+
+	index_t *row_count = calloc(CSR->nr + 1, INDEX_SIZE);
+	IS_POINTER_VALID(row_count);
+
+	int64_t entries = 0;
+	int failed 		= 0;
+
+	//Pass 1: count the entries of each row
+	#pragma omp parallel reduction(+:entries) reduction(|:failed)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+		size_t begin 	= chunk_begin(data, size, header.data_begin, tid, nthreads);
+		size_t end 		= chunk_begin(data, size, header.data_begin, tid + 1, nthreads);
+
+		int64_t n = parse_chunk(data + begin, data + end, &header, 1, row_count, CSR);
+		if (n < 0) {
+			failed = 1;
+		}
+		else {
+			entries += n;
+		}
+	}
+
+	if (failed || (entries != header.entries)) {
+		fprintf(stderr, "Malformed entries in '%s'.\n", filename);
+		free(row_count);
+		munmap((void *)data, size);
+		return -1;
+	}
+
+	//Allocate the CSR arrays and turn the row counts into row pointers
+	index_t nnz = 0;
+	for (index_t i = 0; i < CSR->nr; i++) {
+		nnz += row_count[i];
+	}
+	CSR->nnz = nnz;
+	reset_matrix_storage(CSR);
+	reserve_CSR_matrix(CSR, 0);
+
+	CSR->ia[0] = 0;
+	for (index_t i = 0; i < CSR->nr; i++) {
+		CSR->ia[i + 1] 	= CSR->ia[i] + row_count[i];
+		row_count[i] 	= CSR->ia[i];
+	}
+
+	//Pass 2: scatter the entries into their rows
+	#pragma omp parallel
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+		size_t begin 	= chunk_begin(data, size, header.data_begin, tid, nthreads);
+		size_t end 		= chunk_begin(data, size, header.data_begin, tid + 1, nthreads);
+
+		parse_chunk(data + begin, data + end, &header, 0, row_count, CSR);
+	}
+
+	munmap((void *)data, size);
+	free(row_count);
+
+	//The threads fill each row in arbitrary order
+	#pragma omp parallel for schedule(dynamic, 256)
+	for (index_t i = 0; i < CSR->nr; i++) {
+		sort_row_by_column(CSR->ja + CSR->ia[i], CSR->a + CSR->ia[i], CSR->ia[i + 1] - CSR->ia[i]);
+	}
+
+	INSTRUMENT_END(OP_READ_MATRIX_MARKET, size + COMPRESSED_BYTES(CSR->nr, CSR->nnz), CSR->nnz);
+	return 0;
+}
+
+
+uint64_t binary_checksum(uint64_t seed, const void *data, size_t len) {
+
+	const uint32_t 	*words 	= (const uint32_t *)data;
+	size_t 			n 		= len / sizeof(uint32_t);
+	uint64_t 		h 		= seed;
+
+	for (size_t i = 0; i < n; i++) {
+		h ^= words[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+
+//Number of entries of ia and ja for the given storage format
+static void section_lengths(const SparseMatrix *mat, SparseFormat format, uint64_t *ia_length, uint64_t *ja_length) {
+
+	*ia_length = (format == FORMAT_CSR) ? (uint64_t)mat->nr + 1 : (uint64_t)mat->nnz;
+	*ja_length = (format == FORMAT_CSC) ? (uint64_t)mat->nc + 1 : (uint64_t)mat->nnz;
+}
+
+
+static uint64_t align_offset(uint64_t offset) {
+
+	return (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+}
+
+
+//Writes a section and pads the file up to the next aligned offset
+static int write_section(FILE *file, const void *data, size_t len) {
+
+	static const char zeros[BINARY_ALIGNMENT] = {0};
+
+	if ((len > 0) && (fwrite(data, 1, len, file) != len)) {
+		return -1;
+	}
+	size_t padding = align_offset(len) - len;
+	if ((padding > 0) && (fwrite(zeros, 1, padding, file) != padding)) {
+		return -1;
+	}
+	return 0;
+}
+
+
+void init_binary_header(BinaryHeader *header, SparseFormat format, uint64_t nr, uint64_t nc, uint64_t nnz,
+						uint64_t ia_length, uint64_t ja_length) {
+
+	memset(header, 0, sizeof(BinaryHeader));
+
+	memcpy(header->magic, BINARY_MAGIC, sizeof(header->magic));
+	header->version 	= BINARY_VERSION;
+	header->byte_order 	= BINARY_BYTE_ORDER;
+	header->format 		= format;
+	header->index_size 	= INDEX_SIZE;
+	header->value_size 	= DOUBLE_SIZE;
+	header->nr 			= nr;
+	header->nc 			= nc;
+	header->nnz 		= nnz;
+	header->ia_length 	= ia_length;
+	header->ja_length 	= ja_length;
+
+	header->ia_offset 	= align_offset(sizeof(BinaryHeader));
+	header->ja_offset 	= header->ia_offset + align_offset(ia_length * INDEX_SIZE);
+	header->a_offset 	= header->ja_offset + align_offset(ja_length * INDEX_SIZE);
+}
+
+
+int write_binary_matrix(const char *filename, const SparseMatrix *mat, SparseFormat format) {
+
+	INSTRUMENT_BEGIN();
+
+	BinaryHeader header;
+	uint64_t ia_length, ja_length;
+	section_lengths(mat, format, &ia_length, &ja_length);
+	init_binary_header(&header, format, mat->nr, mat->nc, mat->nnz, ia_length, ja_length);
+
+	header.ia_checksum 	= binary_checksum(BINARY_CHECKSUM_SEED, mat->ia, header.ia_length * INDEX_SIZE);
+	header.ja_checksum 	= binary_checksum(BINARY_CHECKSUM_SEED, mat->ja, header.ja_length * INDEX_SIZE);
+	header.a_checksum 	= binary_checksum(BINARY_CHECKSUM_SEED, mat->a, (size_t)mat->nnz * DOUBLE_SIZE);
+
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot open '%s' for writing.\n", filename);
+		return -1;
+	}
+
+	int status = write_section(file, &header, sizeof(header));
+	if (status == 0) {
+		status = write_section(file, mat->ia, header.ia_length * INDEX_SIZE);
+	}
+	if (status == 0) {
+		status = write_section(file, mat->ja, header.ja_length * INDEX_SIZE);
+	}
+	if (status == 0) {
+		status = write_section(file, mat->a, (size_t)mat->nnz * DOUBLE_SIZE);
+	}
+	if (fclose(file) != 0) {
+		status = -1;
+	}
+
+	if (status != 0) {
+		fprintf(stderr, "Cannot write '%s'.\n", filename);
+	}
+
+	INSTRUMENT_END(OP_WRITE_BINARY, sizeof(header) + (header.ia_length + header.ja_length) * INDEX_SIZE + (uint64_t)mat->nnz * DOUBLE_SIZE, mat->nnz);
+	return status;
+}
+
+
+int validate_binary_header(const BinaryHeader *header, size_t size) {
+
+	if ((memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) != 0) ||
+		(header->version != BINARY_VERSION) || (header->byte_order != BINARY_BYTE_ORDER)) {
+		return -1;
+	}
+
+	if ((header->format < FORMAT_COO) || (header->format > FORMAT_CSC) ||
+		(header->index_size != INDEX_SIZE) || (header->value_size != DOUBLE_SIZE)) {
+		return -1;
+	}
+
+	//The dimensions must fit in index_t, with room for the nr + 1 and nc + 1 pointers
+	if ((header->nr >= (uint64_t)INDEX_MAX) || (header->nc >= (uint64_t)INDEX_MAX) || (header->nnz > (uint64_t)INDEX_MAX)) {
+		return -1;
+	}
+
+	//The section lengths are implied by the format and the dimensions
+	uint64_t ia_length = (header->format == FORMAT_CSR) ? header->nr + 1 : header->nnz;
+	uint64_t ja_length = (header->format == FORMAT_CSC) ? header->nc + 1 : header->nnz;
+	if ((header->ia_length != ia_length) || (header->ja_length != ja_length) ||
+		(ia_length > UINT64_MAX / INDEX_SIZE) || (ja_length > UINT64_MAX / INDEX_SIZE) ||
+		(header->nnz > UINT64_MAX / DOUBLE_SIZE)) {
+		return -1;
+	}
+
+	uint64_t offsets[3] = {header->ia_offset, header->ja_offset, header->a_offset};
+	uint64_t lengths[3] = {ia_length * INDEX_SIZE, ja_length * INDEX_SIZE, header->nnz * DOUBLE_SIZE};
+
+	for (int i = 0; i < 3; i++) {
+		if ((offsets[i] % BINARY_ALIGNMENT != 0) || (offsets[i] > size) || (lengths[i] > size - offsets[i])) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * Checks that the pointer array of a CSR or CSC matrix starts at 0, is nondecreasing and ends at
+ * nnz, and that every index lies in [0, bound); the COO indices are only range-checked.*/
+static int validate_structure(const SparseMatrix *mat, SparseFormat format) {
+
+	const index_t 	*ptr 	= (format == FORMAT_CSC) ? mat->ja : mat->ia;
+	const index_t 	*idx 	= (format == FORMAT_CSC) ? mat->ia : mat->ja;
+	index_t 		n 		= (format == FORMAT_CSC) ? mat->nc : mat->nr;
+	index_t 		bound 	= (format == FORMAT_CSC) ? mat->nr : mat->nc;
+	int 			invalid = 0;
+
+	if (format != FORMAT_COO) {
+		if ((ptr[0] != 0) || (ptr[n] != mat->nnz)) {
+			return -1;
+		}
+		#pragma omp parallel for schedule(static) reduction(+ : invalid) if (n > PARALLEL_NNZ_THRESHOLD)
+		for (index_t i = 0; i < n; i++) {
+			invalid += (ptr[i] > ptr[i + 1]);
+		}
+	}
+
+	#pragma omp parallel for schedule(static) reduction(+ : invalid) if (mat->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t k = 0; k < mat->nnz; k++) {
+		invalid += (idx[k] < 0) || (idx[k] >= bound);
+		if (format == FORMAT_COO) {
+			invalid += (mat->ia[k] < 0) || (mat->ia[k] >= mat->nr);
+		}
+	}
+	return (invalid == 0) ? 0 : -1;
+}
+
+
+int map_binary_matrix(const char *filename, MappedMatrix *map, int verify) {
+
+	INSTRUMENT_BEGIN();
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot open '%s'.\n", filename);
+		return -1;
+	}
+
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(BinaryHeader))) {
+		fprintf(stderr, "'%s' is not a binary matrix file.\n", filename);
+		close(fd);
+		return -1;
+	}
+
+	void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		fprintf(stderr, "Cannot map '%s'.\n", filename);
+		return -1;
+	}
+
+	const BinaryHeader *header = (const BinaryHeader *)base;
+	if (validate_binary_header(header, st.st_size) != 0) {
+		fprintf(stderr, "'%s' is not a valid binary matrix file.\n", filename);
+		munmap(base, st.st_size);
+		return -1;
+	}
+
+	char *bytes = (char *)base;
+	map->base 		= base;
+	map->size 		= st.st_size;
+	map->format 	= header->format;
+	map->mat.nr 	= header->nr;
+	map->mat.nc 	= header->nc;
+	map->mat.nnz 	= header->nnz;
+	map->mat.ia 	= (index_t *)(bytes + header->ia_offset);
+	map->mat.ja 	= (index_t *)(bytes + header->ja_offset);
+	map->mat.a 		= (double *)(bytes + header->a_offset);
+	map->mat.mem 	= NULL;
+	map->mat.capacity 	= 0;
+
+	if (verify &&
+		((binary_checksum(BINARY_CHECKSUM_SEED, map->mat.ia, header->ia_length * INDEX_SIZE) != header->ia_checksum) ||
+		 (binary_checksum(BINARY_CHECKSUM_SEED, map->mat.ja, header->ja_length * INDEX_SIZE) != header->ja_checksum) ||
+		 (binary_checksum(BINARY_CHECKSUM_SEED, map->mat.a, header->nnz * DOUBLE_SIZE) != header->a_checksum))) {
+		fprintf(stderr, "Checksum mismatch in '%s'.\n", filename);
+		unmap_binary_matrix(map);
+		return -1;
+	}
+
+	if (verify && (validate_structure(&map->mat, map->format) != 0)) {
+		fprintf(stderr, "Invalid row/column pointers or indices in '%s'.\n", filename);
+		unmap_binary_matrix(map);
+		return -1;
+	}
+
+	INSTRUMENT_END(OP_MAP_BINARY, verify ? map->size : sizeof(BinaryHeader), map->mat.nnz);
+	return 0;
+}
+
+
+void unmap_binary_matrix(MappedMatrix *map) {
+
+	munmap(map->base, map->size);
+	map->base = NULL;
+	map->size = 0;
+}
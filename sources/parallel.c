@@ -0,0 +1,116 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parallel.h"
+#include "utilities.h"
+
+
+index_t nnz_balanced_row_split(const index_t *ia, index_t nr, int part, int nparts) {
+
+	if (part <= 0) {
+		return 0;
+	}
+	if (part >= nparts) {
+		return nr;
+	}
+
+	//Smallest row whose first nonzero entry is at or beyond the target
+	index_t target = BLOCK_BEGIN(ia[nr], part, nparts);
+	return (index_t)lower_bound_index(ia, nr, target);
+}
+
+
+void merge_path_search(const index_t *ia, index_t nr, index_t nnz, int64_t diagonal, index_t *row, index_t *nz) {
+
+	index_t low 	= (diagonal > nnz) ? (index_t)(diagonal - nnz) : 0;
+	index_t high 	= (diagonal < nr) ? (index_t)diagonal : nr;
+
+	while (low < high) {
+		index_t pivot = low + (high - low) / 2;
+		if (ia[pivot + 1] <= diagonal - pivot - 1) {
+			low = pivot + 1;
+		}
+		else {
+			high = pivot;
+		}
+	}
+
+	*row 	= low;
+	*nz 	= (index_t)(diagonal - low);
+}
+
+
+index_t parallel_exclusive_scan(index_t *arr, index_t n) {
+
+	int 	max_threads = get_max_threads();
+	int 	team_size 	= 1;
+	index_t block_sum[max_threads + 1];
+
+	#pragma omp parallel num_threads(max_threads) if (n > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+		index_t begin 	= BLOCK_BEGIN(n, tid, nthreads);
+		index_t end 	= BLOCK_BEGIN(n, tid + 1, nthreads);
+
+		//Step 1: every thread sums its own block
+		index_t sum = 0;
+		for (index_t i = begin; i < end; i++) {
+			sum += arr[i];
+		}
+		block_sum[tid + 1] = sum;
+
+		#pragma omp barrier
+
+		//Step 2: scan of the block sums
+		#pragma omp single
+		{
+			team_size 		= nthreads;
+			block_sum[0] 	= 0;
+			for (int t = 0; t < nthreads; t++) {
+				block_sum[t + 1] += block_sum[t];
+			}
+		}
+
+		//Step 3: every thread scans its block, starting from the sum of the previous blocks
+		index_t offset = block_sum[tid];
+		for (index_t i = begin; i < end; i++) {
+			index_t count 	= arr[i];
+			arr[i] 			= offset;
+			offset 		+= count;
+		}
+	}
+
+	return block_sum[team_size];
+}
@@ -0,0 +1,323 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "raster.h"
+#include "instrument.h"
+
+
+int compute_density_grid(const SparseMatrix *CSR, int width, int height, DensityGrid *grid) {
+
+	INSTRUMENT_BEGIN();
+
+	memset(grid, 0, sizeof(DensityGrid));
+	if ((CSR->nr <= 0) || (CSR->nc <= 0) || (width <= 0) || (height <= 0)) {
+		fprintf(stderr, "compute_density_grid: empty matrix or grid.\n");
+		return -1;
+	}
+
+	const index_t 	*ia = CSR->ia;
+	const index_t 	*ja = CSR->ja;
+	index_t 		nr 	= CSR->nr;
+	index_t 		nc 	= CSR->nc;
+
+	grid->width 	= width;
+	grid->height 	= height;
+	grid->count 	= calloc((size_t)width * height, sizeof(uint64_t));
+	IS_POINTER_VALID(grid->count);
+
+	//A multiplication instead of a division per entry; the clamp catches the rounding up at the last cell
+	double 		column_scale 	= (double)width / nc;
+	uint64_t 	max_count 		= 0;
+
+	#pragma omp parallel if (CSR->nnz > PARALLEL_NNZ_THRESHOLD) reduction(max : max_count)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+
+		/**
+		 * The nnz-balanced row blocks are moved back to the first row of their grid row,
+		 * so that no grid row is shared by two threads and the counts need no atomics.*/
+		index_t split[2];
+		for (int k = 0; k < 2; k++) {
+			index_t row 	= nnz_balanced_row_split(ia, nr, tid + k, nthreads);
+			int64_t cell 	= (int64_t)row * height / nr;
+			split[k] 		= (row == nr) ? nr : (index_t)((cell * nr + height - 1) / height);
+		}
+
+		for (index_t i = split[0]; i < split[1]; i++) {
+
+			uint64_t *cells = grid->count + (size_t)((int64_t)i * height / nr) * width;
+			for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+				int x = (int)(ja[j] * column_scale);
+				cells[(x < width) ? x : width - 1]++;
+			}
+		}
+
+		int64_t cell_begin 	= (int64_t)split[0] * height / nr;
+		int64_t cell_end 	= (split[1] == nr) ? height : (int64_t)split[1] * height / nr;
+		for (size_t c = (size_t)cell_begin * width; c < (size_t)cell_end * width; c++) {
+			max_count = (grid->count[c] > max_count) ? grid->count[c] : max_count;
+		}
+	}
+
+	grid->max_count = max_count;
+
+	INSTRUMENT_END(OP_DENSITY_GRID, ((uint64_t)nr + 1 + CSR->nnz) * INDEX_SIZE + (uint64_t)width * height * sizeof(uint64_t), CSR->nnz);
+	return 0;
+}
+
+
+//Gray level of a cell: white when empty, and at least a light gray for a single entry
+static unsigned char shade_cell(uint64_t count, double log_max) {
+
+	if (count == 0) {
+		return 255;
+	}
+	double level = (log_max > 0.0) ? log1p((double)count) / log_max : 1.0;
+	return (unsigned char)(215.0 - 215.0 * level + 0.5);
+}
+
+
+//Scales the grid to the image with nearest-neighbour sampling, one byte per pixel
+static unsigned char *shade_image(const DensityGrid *grid, int width, int height) {
+
+	unsigned char *pixels = malloc((size_t)width * height);
+	IS_POINTER_VALID(pixels);
+
+	double log_max = log1p((double)grid->max_count);
+
+	#pragma omp parallel for if ((size_t)width * height > PARALLEL_NNZ_THRESHOLD)
+	for (int y = 0; y < height; y++) {
+
+		const uint64_t *cells = grid->count + (size_t)((int64_t)y * grid->height / height) * grid->width;
+		for (int x = 0; x < width; x++) {
+			pixels[(size_t)y * width + x] = shade_cell(cells[(int64_t)x * grid->width / width], log_max);
+		}
+	}
+	return pixels;
+}
+
+
+//CRC-32 of the PNG chunks (polynomial 0xedb88320)
+static void init_crc_table(uint32_t *table) {
+
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		}
+		table[n] = c;
+	}
+}
+
+
+static uint32_t crc32_update(const uint32_t *table, uint32_t crc, const unsigned char *data, size_t len) {
+
+	crc = ~crc;
+	for (size_t i = 0; i < len; i++) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+
+static void put_be32(unsigned char *p, uint32_t v) {
+
+	p[0] = (unsigned char)(v >> 24);
+	p[1] = (unsigned char)(v >> 16);
+	p[2] = (unsigned char)(v >> 8);
+	p[3] = (unsigned char)v;
+}
+
+
+//Writes a PNG chunk: length, type, data and the CRC of type and data
+static int write_png_chunk(FILE *file, const uint32_t *table, const char *type, const unsigned char *data, size_t len) {
+
+	unsigned char word[4];
+	put_be32(word, (uint32_t)len);
+	uint32_t crc = crc32_update(table, crc32_update(table, 0, (const unsigned char *)type, 4), data, len);
+
+	int failed = (fwrite(word, 1, 4, file) != 4) || (fwrite(type, 1, 4, file) != 4) ||
+				 ((len > 0) && (fwrite(data, 1, len, file) != len));
+	put_be32(word, crc);
+	failed |= (fwrite(word, 1, 4, file) != 4);
+	return failed ? -1 : 0;
+}
+
+
+/**
+ * 8-bit grayscale PNG. The zlib stream is made of stored (uncompressed) deflate blocks,
+ * so that no compression library is needed; the image size does not depend on nnz anyway.*/
+static int write_png(FILE *file, const unsigned char *pixels, int width, int height) {
+
+	//Step 1: raw scanlines, each one preceded by its filter type (none)
+	size_t stride 	= (size_t)width + 1;
+	size_t raw_len 	= stride * height;
+	unsigned char *raw = malloc(raw_len);
+	IS_POINTER_VALID(raw);
+
+	for (int y = 0; y < height; y++) {
+		raw[y * stride] = 0;
+		memcpy(raw + y * stride + 1, pixels + (size_t)y * width, width);
+	}
+
+	//Step 2: zlib stream of stored blocks of at most 65535 bytes, with the Adler-32 of the raw data
+	size_t nblocks 	= (raw_len + 65534) / 65535;
+	size_t zlib_len = 2 + raw_len + 5 * nblocks + 4;
+	unsigned char *zlib = malloc(zlib_len);
+	IS_POINTER_VALID(zlib);
+
+	unsigned char *p = zlib;
+	*p++ = 0x78;
+	*p++ = 0x01;
+
+	uint32_t s1 = 1, s2 = 0;
+	for (size_t offset = 0; offset < raw_len; offset += 65535) {
+
+		size_t len = (raw_len - offset < 65535) ? raw_len - offset : 65535;
+		*p++ = (offset + len == raw_len);
+		*p++ = (unsigned char)len;
+		*p++ = (unsigned char)(len >> 8);
+		*p++ = (unsigned char)~len;
+		*p++ = (unsigned char)(~len >> 8);
+		memcpy(p, raw + offset, len);
+		p += len;
+
+		for (size_t i = 0; i < len; i++) {
+			s1 = (s1 + raw[offset + i]) % 65521;
+			s2 = (s2 + s1) % 65521;
+		}
+	}
+	put_be32(p, (s2 << 16) | s1);
+
+	//Step 3: signature, header, data and end chunks
+	static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	unsigned char ihdr[13] = {0};
+	put_be32(ihdr, (uint32_t)width);
+	put_be32(ihdr + 4, (uint32_t)height);
+	ihdr[8] = 8;			//bit depth; color type 0 (grayscale), no interlace
+
+	uint32_t table[256];
+	init_crc_table(table);
+
+	int status = (fwrite(signature, 1, 8, file) != 8) ? -1 : 0;
+	if (status == 0) {
+		status = write_png_chunk(file, table, "IHDR", ihdr, sizeof(ihdr));
+	}
+	if (status == 0) {
+		status = write_png_chunk(file, table, "IDAT", zlib, zlib_len);
+	}
+	if (status == 0) {
+		status = write_png_chunk(file, table, "IEND", NULL, 0);
+	}
+
+	free(raw);
+	free(zlib);
+	return status;
+}
+
+
+int write_density_image(const DensityGrid *grid, int width, int height, const char *filename) {
+
+	if ((width <= 0) || (height <= 0)) {
+		return -1;
+	}
+
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot open '%s' for writing.\n", filename);
+		return -1;
+	}
+
+	unsigned char *pixels = shade_image(grid, width, height);
+
+	size_t 	len 	= strlen(filename);
+	int 	status 	= 0;
+	if ((len >= 4) && (strcmp(filename + len - 4, ".pgm") == 0)) {
+		size_t npixels = (size_t)width * height;
+		status = ((fprintf(file, "P5\n%d %d\n255\n", width, height) < 0) ||
+				  (fwrite(pixels, 1, npixels, file) != npixels)) ? -1 : 0;
+	}
+	else {
+		status = write_png(file, pixels, width, height);
+	}
+
+	if (fclose(file) != 0) {
+		status = -1;
+	}
+	if (status != 0) {
+		fprintf(stderr, "Cannot write '%s'.\n", filename);
+	}
+
+	free(pixels);
+	return status;
+}
+
+
+int render_sparsity_pattern(const SparseMatrix *CSR, int resolution, const char *filename) {
+
+	if ((CSR->nr <= 0) || (CSR->nc <= 0) || (resolution <= 0)) {
+		fprintf(stderr, "render_sparsity_pattern: empty matrix or image.\n");
+		return -1;
+	}
+
+	//Image with the aspect ratio of the matrix, and a grid no finer than the matrix itself
+	index_t n 	= (CSR->nr > CSR->nc) ? CSR->nr : CSR->nc;
+	int width 	= (int)((int64_t)resolution * CSR->nc / n);
+	int height 	= (int)((int64_t)resolution * CSR->nr / n);
+	width 		= (width < 1) ? 1 : width;
+	height 		= (height < 1) ? 1 : height;
+
+	int grid_width 	= (CSR->nc < width) ? (int)CSR->nc : width;
+	int grid_height = (CSR->nr < height) ? (int)CSR->nr : height;
+
+	DensityGrid grid;
+	if (compute_density_grid(CSR, grid_width, grid_height, &grid) != 0) {
+		return -1;
+	}
+
+	int status = write_density_image(&grid, width, height, filename);
+	deallocate_density_grid(&grid);
+	return status;
+}
+
+
+void deallocate_density_grid(DensityGrid *grid) {
+
+	free(grid->count);
+	grid->count 	= NULL;
+	grid->width 	= 0;
+	grid->height 	= 0;
+	grid->max_count = 0;
+}
@@ -0,0 +1,407 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "reorder.h"
+#include "instrument.h"
+
+
+//Adjacency structure of a graph, in CSR-like layout without values
+typedef struct {
+	index_t 	n;
+	index_t 	*ptr;
+	index_t 	*adj;
+} Graph;
+
+
+/**
+ * Builds the graph of A + A^T without self loops: row i is the union of row i of A and of its
+ * transpose, merged as two sorted lists. A first pass counts the entries of every row and a
+ * second one writes them.*/
+static void build_symmetric_graph(const SparseMatrix *CSR, Graph *G) {
+
+	SparseMatrix T;
+	transpose_CSR_parallel(CSR, &T);
+
+	index_t n 	= CSR->nr;
+	G->n 		= n;
+	G->ptr 		= malloc(((size_t)n + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(G->ptr);
+
+	for (int pass = 0; pass < 2; pass++) {
+
+		#pragma omp parallel for schedule(dynamic, 256) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+		for (index_t i = 0; i < n; i++) {
+
+			index_t p = CSR->ia[i], p_end = CSR->ia[i + 1];
+			index_t q = T.ia[i], q_end = T.ia[i + 1];
+			index_t count = 0;
+
+			while ((p < p_end) || (q < q_end)) {
+
+				index_t col;
+				if ((q == q_end) || ((p < p_end) && (CSR->ja[p] < T.ja[q]))) {
+					col = CSR->ja[p++];
+				}
+				else if ((p == p_end) || (T.ja[q] < CSR->ja[p])) {
+					col = T.ja[q++];
+				}
+				else {
+					col = CSR->ja[p++];
+					q++;
+				}
+
+				if (col != i) {
+					if (pass == 1) {
+						G->adj[G->ptr[i] + count] = col;
+					}
+					count++;
+				}
+			}
+
+			if (pass == 0) {
+				G->ptr[i] = count;
+			}
+		}
+
+		if (pass == 0) {
+			G->ptr[n] = 0;
+			index_t nnz = parallel_exclusive_scan(G->ptr, n + 1);
+			G->adj = malloc(((size_t)nnz + 1) * INDEX_SIZE);
+			IS_POINTER_VALID(G->adj);
+		}
+	}
+
+	deallocate_sparse_matrix(&T);
+}
+
+
+static void deallocate_graph(Graph *G) {
+
+	free(G->ptr);
+	free(G->adj);
+}
+
+
+#define DEGREE(G, i) 	((G)->ptr[(i) + 1] - (G)->ptr[i])
+
+
+//Stable counting sort of the nodes by degree
+static void sort_nodes_by_degree(const Graph *G, index_t *order) {
+
+	index_t n 		= G->n;
+	index_t *start 	= calloc((size_t)n + 1, INDEX_SIZE);
+	IS_POINTER_VALID(start);
+
+	for (index_t i = 0; i < n; i++) {
+		start[DEGREE(G, i) + 1]++;
+	}
+	for (index_t d = 0; d < n; d++) {
+		start[d + 1] += start[d];
+	}
+	for (index_t i = 0; i < n; i++) {
+		order[start[DEGREE(G, i)]++] = i;
+	}
+
+	free(start);
+}
+
+
+//Sorts count nodes by increasing degree; the sort is stable, so ties keep their order
+static void sort_by_degree(const Graph *G, index_t *nodes, index_t count, uint64_t *keys, int degree_bits) {
+
+	if (count <= 32) {
+		for (index_t k = 1; k < count; k++) {
+			index_t v 	= nodes[k];
+			index_t d 	= DEGREE(G, v);
+			index_t m 	= k - 1;
+			while ((m >= 0) && (DEGREE(G, nodes[m]) > d)) {
+				nodes[m + 1] = nodes[m];
+				m--;
+			}
+			nodes[m + 1] = v;
+		}
+		return;
+	}
+
+	for (index_t k = 0; k < count; k++) {
+		keys[k] = (uint64_t)DEGREE(G, nodes[k]);
+	}
+	radix_sort_pairs(keys, nodes, count, degree_bits);
+}
+
+
+/**
+ * Breadth-first search from root, writing the nodes in visiting order to queue and marking them
+ * with stamp; nodes whose mark already equals stamp are skipped. The search stays within the
+ * connected component of root. With by_degree set, the neighbours of each node are appended by
+ * increasing degree, which is the Cuthill-McKee order.
+ * @return	the number of nodes visited; *depth is the number of levels, and *last_level the
+ * 			offset of the last level in queue.*/
+static index_t breadth_first_search(const Graph *G, index_t root, index_t *mark, index_t stamp, index_t *queue,
+									int by_degree, uint64_t *keys, int degree_bits, index_t *depth, index_t *last_level) {
+
+	index_t head 		= 0;
+	index_t tail 		= 1;
+	index_t level_end 	= 1;
+
+	queue[0] 	= root;
+	mark[root] 	= stamp;
+	*depth 		= 1;
+	*last_level = 0;
+
+	while (head < tail) {
+
+		if (head == level_end) {
+			*last_level = level_end;
+			level_end 	= tail;
+			(*depth)++;
+		}
+
+		index_t u 		= queue[head++];
+		index_t first 	= tail;
+
+		for (index_t j = G->ptr[u]; j < G->ptr[u + 1]; j++) {
+			index_t v = G->adj[j];
+			if (mark[v] != stamp) {
+				mark[v] 		= stamp;
+				queue[tail++] 	= v;
+			}
+		}
+
+		if (by_degree) {
+			sort_by_degree(G, queue + first, tail - first, keys, degree_bits);
+		}
+	}
+
+	return tail;
+}
+
+
+//Number of bits needed to represent the values 0, ..., n
+static int degree_bits(index_t n) {
+
+	int bits = 1;
+	while ((bits < 63) && (((int64_t)1 << bits) <= n)) {
+		bits++;
+	}
+	return bits;
+}
+
+
+/**
+ * The starting node of each component is pseudo-peripheral (George and Liu): starting from the
+ * unvisited node of lowest degree, the search moves to the lowest-degree node of the last level
+ * as long as this increases the number of levels.*/
+int compute_RCM_ordering(const SparseMatrix *CSR, index_t *perm) {
+
+	INSTRUMENT_BEGIN();
+
+	if (CSR->nr != CSR->nc) {
+		fprintf(stderr, "RCM: the matrix is not square.\n");
+		return -1;
+	}
+
+	Graph G;
+	build_symmetric_graph(CSR, &G);
+
+	index_t n 		= G.n;
+	index_t *order 	= malloc(((size_t)n + 1) * INDEX_SIZE);
+	index_t *mark 	= calloc((size_t)n + 1, INDEX_SIZE);
+	uint64_t *keys 	= malloc(((size_t)n + 1) * sizeof(uint64_t));
+	IS_POINTER_VALID(order);
+	IS_POINTER_VALID(mark);
+	IS_POINTER_VALID(keys);
+
+	sort_nodes_by_degree(&G, order);
+
+	int bits 		= degree_bits(n);
+	index_t stamp 	= 0;
+	index_t pos 	= 0;
+
+	for (index_t s = 0; s < n; s++) {
+
+		index_t root = order[s];
+		if (mark[root] != 0) {
+			continue;
+		}
+
+		//Step 1: pseudo-peripheral node of the component, using perm + pos as queue
+		index_t *queue = perm + pos;
+		index_t depth, last_level, count;
+		count = breadth_first_search(&G, root, mark, ++stamp, queue, 0, keys, bits, &depth, &last_level);
+
+		while (1) {
+
+			index_t candidate = queue[last_level];
+			for (index_t k = last_level + 1; k < count; k++) {
+				if (DEGREE(&G, queue[k]) < DEGREE(&G, candidate)) {
+					candidate = queue[k];
+				}
+			}
+
+			index_t candidate_depth, candidate_last;
+			count = breadth_first_search(&G, candidate, mark, ++stamp, queue, 0, keys, bits, &candidate_depth, &candidate_last);
+
+			if (candidate_depth <= depth) {
+				break;
+			}
+			root 		= candidate;
+			depth 		= candidate_depth;
+			last_level 	= candidate_last;
+		}
+
+		//Step 2: Cuthill-McKee order of the component
+		count 	= breadth_first_search(&G, root, mark, ++stamp, queue, 1, keys, bits, &depth, &last_level);
+		pos 	+= count;
+	}
+
+	//Step 3: reverse the order
+	for (index_t i = 0; i < n / 2; i++) {
+		index_t tmp 		= perm[i];
+		perm[i] 			= perm[n - 1 - i];
+		perm[n - 1 - i] 	= tmp;
+	}
+
+	free(order);
+	free(mark);
+	free(keys);
+	deallocate_graph(&G);
+
+	INSTRUMENT_END(OP_RCM_ORDERING, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + (uint64_t)n * INDEX_SIZE, CSR->nnz);
+	return 0;
+}
+
+
+int compute_degree_ordering(const SparseMatrix *CSR, index_t *perm) {
+
+	if (CSR->nr != CSR->nc) {
+		fprintf(stderr, "Degree ordering: the matrix is not square.\n");
+		return -1;
+	}
+
+	Graph G;
+	build_symmetric_graph(CSR, &G);
+	sort_nodes_by_degree(&G, perm);
+	deallocate_graph(&G);
+	return 0;
+}
+
+
+void invert_permutation(const index_t *perm, index_t n, index_t *inverse) {
+
+	#pragma omp parallel for if (n > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < n; i++) {
+		inverse[perm[i]] = i;
+	}
+}
+
+
+void permute_CSR(const index_t *P, const SparseMatrix *A, const index_t *Q, SparseMatrix *B) {
+
+	INSTRUMENT_BEGIN();
+
+	B->nr 	= A->nr;
+	B->nc 	= A->nc;
+	B->nnz 	= A->nnz;
+	reset_matrix_storage(B);
+	reserve_CSR_matrix(B, 0);
+
+	//Step 1: row pointers from the lengths of the permuted rows
+	#pragma omp parallel for if (A->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < A->nr; i++) {
+		index_t row = P ? P[i] : i;
+		B->ia[i] 	= A->ia[row + 1] - A->ia[row];
+	}
+	B->ia[A->nr] = 0;
+	parallel_exclusive_scan(B->ia, A->nr + 1);
+
+	//Step 2: copy the rows, renumbering and sorting their columns
+	index_t *q_inverse = NULL;
+	if (Q) {
+		q_inverse = malloc(((size_t)A->nc + 1) * INDEX_SIZE);
+		IS_POINTER_VALID(q_inverse);
+		invert_permutation(Q, A->nc, q_inverse);
+	}
+
+	#pragma omp parallel for schedule(dynamic, 256) if (A->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < A->nr; i++) {
+
+		index_t row 	= P ? P[i] : i;
+		index_t offset 	= B->ia[i] - A->ia[row];
+
+		for (index_t j = A->ia[row]; j < A->ia[row + 1]; j++) {
+			B->ja[j + offset] 	= Q ? q_inverse[A->ja[j]] : A->ja[j];
+			B->a[j + offset] 	= A->a[j];
+		}
+
+		if (Q) {
+			sort_row_by_column(B->ja + B->ia[i], B->a + B->ia[i], B->ia[i + 1] - B->ia[i]);
+		}
+	}
+
+	free(q_inverse);
+
+	INSTRUMENT_END(OP_PERMUTE_CSR, 2 * COMPRESSED_BYTES(A->nr, A->nnz), A->nnz);
+}
+
+
+index_t matrix_bandwidth(const SparseMatrix *CSR) {
+
+	index_t bandwidth = 0;
+
+	#pragma omp parallel for reduction(max:bandwidth) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < CSR->nr; i++) {
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+			index_t d = (CSR->ja[j] > i) ? CSR->ja[j] - i : i - CSR->ja[j];
+			bandwidth = (d > bandwidth) ? d : bandwidth;
+		}
+	}
+	return bandwidth;
+}
+
+
+int64_t matrix_profile(const SparseMatrix *CSR) {
+
+	int64_t profile = 0;
+
+	#pragma omp parallel for reduction(+:profile) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < CSR->nr; i++) {
+		index_t first = i;
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+			first = (CSR->ja[j] < first) ? CSR->ja[j] : first;
+		}
+		profile += i - first;
+	}
+	return profile;
+}
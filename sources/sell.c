@@ -0,0 +1,352 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "sell.h"
+#include "instrument.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SELL_X86_KERNELS
+#include <immintrin.h>
+
+//Gathers 4 or 8 entries of x through the column indices stored at idx
+#ifdef SPARSE_INDEX_64
+#define GATHER4_PD(x, idx) 	_mm256_i64gather_pd(x, _mm256_loadu_si256((const __m256i *)(idx)), 8)
+#define GATHER8_PD(x, idx) 	_mm512_i64gather_pd(_mm512_loadu_si512(idx), x, 8)
+#else
+#define GATHER4_PD(x, idx) 	_mm256_i32gather_pd(x, _mm_loadu_si128((const __m128i *)(idx)), 8)
+#define GATHER8_PD(x, idx) 	_mm512_i32gather_pd(_mm256_loadu_si256((const __m256i *)(idx)), x, 8)
+#endif
+#endif
+
+
+//Row length paired with its row index, used for the sigma-window sorting
+typedef struct {
+	index_t 	len;
+	index_t 	row;
+} RowLength;
+
+
+//Sorts by decreasing length; ties keep the original row order
+static int compare_row_length(const void *v1, const void *v2) {
+
+	const RowLength *a = (const RowLength *)v1;
+	const RowLength *b = (const RowLength *)v2;
+	if (a->len != b->len) {
+		return (a->len < b->len) - (a->len > b->len);
+	}
+	return (a->row > b->row) - (a->row < b->row);
+}
+
+
+void convert_CSR_to_SELL(const SparseMatrix *CSR, SellMatrix *SELL, int C, int sigma) {
+
+	INSTRUMENT_BEGIN();
+
+	index_t i, j, k, s;
+
+	if (C < 1) {
+		C = SELL_DEFAULT_C;
+	}
+	if (sigma < 1) {
+		sigma = 1;
+	}
+
+	SELL->nr 		= CSR->nr;
+	SELL->nc 		= CSR->nc;
+	SELL->nnz 		= CSR->nnz;
+	SELL->C 		= C;
+	SELL->sigma 	= sigma;
+	SELL->nslices 	= (CSR->nr + C - 1) / C;
+
+	index_t nrows_padded = SELL->nslices * C;
+
+	//Step 1: sort the rows by decreasing length within each sigma window
+	RowLength *rows = malloc(nrows_padded * sizeof(RowLength));
+	IS_POINTER_VALID(rows);
+
+	for (i = 0; i < nrows_padded; i++) {
+		rows[i].row = (i < CSR->nr) ? i : -1;
+		rows[i].len = (i < CSR->nr) ? CSR->ia[i + 1] - CSR->ia[i] : 0;
+	}
+
+	for (i = 0; i < CSR->nr; i += sigma) {
+		index_t window = (CSR->nr - i < sigma) ? CSR->nr - i : sigma;
+		qsort(rows + i, window, sizeof(RowLength), compare_row_length);
+	}
+
+	//Step 2: the width of a slice is the length of its longest row
+	SELL->slice_ptr = calloc(SELL->nslices + 1, INDEX_SIZE);
+	IS_POINTER_VALID(SELL->slice_ptr);
+
+	SELL->perm = malloc(nrows_padded * INDEX_SIZE);
+	IS_POINTER_VALID(SELL->perm);
+
+	for (s = 0; s < SELL->nslices; s++) {
+
+		index_t width = 0;
+		for (i = s * C; i < (s + 1) * C; i++) {
+			SELL->perm[i] = rows[i].row;
+			if (rows[i].len > width) {
+				width = rows[i].len;
+			}
+		}
+		SELL->slice_ptr[s + 1] = SELL->slice_ptr[s] + width * C;
+	}
+
+	free(rows);
+
+	//Step 3: fill the slices column by column
+	index_t padded_nnz = SELL->slice_ptr[SELL->nslices];
+
+	//Aligned slices keep the vector loads of the kernels within cache lines
+	SELL->ja 	= allocate_aligned(padded_nnz * INDEX_SIZE, 0);
+	SELL->a 	= allocate_aligned(padded_nnz * DOUBLE_SIZE, 0);
+
+	#pragma omp parallel for private(i, j, k) schedule(static) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (s = 0; s < SELL->nslices; s++) {
+
+		index_t offset 	= SELL->slice_ptr[s];
+		index_t width 	= (SELL->slice_ptr[s + 1] - offset) / C;
+
+		for (i = 0; i < C; i++) {
+
+			index_t row 	= SELL->perm[s * C + i];
+			index_t begin 	= (row >= 0) ? CSR->ia[row] : 0;
+			index_t len 	= (row >= 0) ? CSR->ia[row + 1] - begin : 0;
+
+			//Padding repeats the last column of the row, so that the gathers stay in cache
+			index_t pad_col = (len > 0) ? CSR->ja[begin + len - 1] : 0;
+
+			for (j = 0; j < width; j++) {
+				k = offset + j * C + i;
+				if (j < len) {
+					SELL->ja[k] = CSR->ja[begin + j];
+					SELL->a[k] 	= CSR->a[begin + j];
+				}
+				else {
+					SELL->ja[k] = pad_col;
+					SELL->a[k] 	= 0.0;
+				}
+			}
+		}
+	}
+
+	INSTRUMENT_END(OP_CSR_TO_SELL, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + (uint64_t)SELL->slice_ptr[SELL->nslices] * (INDEX_SIZE + DOUBLE_SIZE), CSR->nnz);
+}
+
+
+double SELL_padding_ratio(const SellMatrix *SELL) {
+
+	if (SELL->nnz == 0) {
+		return 1.0;
+	}
+	return (double)SELL->slice_ptr[SELL->nslices] / SELL->nnz;
+}
+
+
+static void spmv_SELL_scalar(const SellMatrix *SELL, const double *x, double *y) {
+
+	int C = SELL->C;
+
+	#pragma omp parallel for schedule(dynamic, 64) if (SELL->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t s = 0; s < SELL->nslices; s++) {
+
+		index_t offset 	= SELL->slice_ptr[s];
+		index_t width 	= (SELL->slice_ptr[s + 1] - offset) / C;
+		double sum[C];
+
+		for (int i = 0; i < C; i++) {
+			sum[i] = 0.0;
+		}
+
+		for (index_t j = 0; j < width; j++) {
+			const index_t 	*col 	= SELL->ja + offset + j * C;
+			const double 	*val 	= SELL->a + offset + j * C;
+			for (int i = 0; i < C; i++) {
+				sum[i] += val[i] * x[col[i]];
+			}
+		}
+
+		for (int i = 0; i < C; i++) {
+			index_t row = SELL->perm[s * C + i];
+			if (row >= 0) {
+				y[row] = sum[i];
+			}
+		}
+	}
+}
+
+
+#ifdef SELL_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+static void spmv_SELL_avx2(const SellMatrix *SELL, const double *x, double *y) {
+
+	int C = SELL->C;
+
+	#pragma omp parallel for schedule(dynamic, 64) if (SELL->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t s = 0; s < SELL->nslices; s++) {
+
+		index_t offset 	= SELL->slice_ptr[s];
+		index_t width 	= (SELL->slice_ptr[s + 1] - offset) / C;
+
+		//Each group of 4 rows of the slice fills one 256-bit register
+		for (int g = 0; g < C; g += 4) {
+
+			__m256d sum = _mm256_setzero_pd();
+			for (index_t j = 0; j < width; j++) {
+				index_t k 	= offset + j * C + g;
+				__m256d val = _mm256_loadu_pd(SELL->a + k);
+				__m256d xv 	= GATHER4_PD(x, SELL->ja + k);
+				sum = _mm256_fmadd_pd(val, xv, sum);
+			}
+
+			double out[4];
+			_mm256_storeu_pd(out, sum);
+			for (int i = 0; i < 4; i++) {
+				index_t row = SELL->perm[s * C + g + i];
+				if (row >= 0) {
+					y[row] = out[i];
+				}
+			}
+		}
+	}
+}
+
+
+__attribute__((target("avx512f")))
+static void spmv_SELL_avx512(const SellMatrix *SELL, const double *x, double *y) {
+
+	int C = SELL->C;
+
+	#pragma omp parallel for schedule(dynamic, 64) if (SELL->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t s = 0; s < SELL->nslices; s++) {
+
+		index_t offset 	= SELL->slice_ptr[s];
+		index_t width 	= (SELL->slice_ptr[s + 1] - offset) / C;
+
+		//Each group of 8 rows of the slice fills one 512-bit register
+		for (int g = 0; g < C; g += 8) {
+
+			__m512d sum = _mm512_setzero_pd();
+			for (index_t j = 0; j < width; j++) {
+				index_t k 	= offset + j * C + g;
+				__m512d val = _mm512_loadu_pd(SELL->a + k);
+				__m512d xv 	= GATHER8_PD(x, SELL->ja + k);
+				sum = _mm512_fmadd_pd(val, xv, sum);
+			}
+
+			double out[8];
+			_mm512_storeu_pd(out, sum);
+			for (int i = 0; i < 8; i++) {
+				index_t row = SELL->perm[s * C + g + i];
+				if (row >= 0) {
+					y[row] = out[i];
+				}
+			}
+		}
+	}
+}
+
+#endif
+
+
+static int SELL_kernel_supported(const SellMatrix *SELL, SellKernel kernel) {
+
+	switch (kernel) {
+	case SELL_KERNEL_SCALAR:
+		return 1;
+#ifdef SELL_X86_KERNELS
+	case SELL_KERNEL_AVX2:
+		return (SELL->C % 4 == 0) && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	case SELL_KERNEL_AVX512:
+		return (SELL->C % 8 == 0) && __builtin_cpu_supports("avx512f");
+#endif
+	default:
+		return 0;
+	}
+}
+
+
+SellKernel select_SELL_kernel(const SellMatrix *SELL) {
+
+	if (SELL_kernel_supported(SELL, SELL_KERNEL_AVX512)) {
+		return SELL_KERNEL_AVX512;
+	}
+	if (SELL_kernel_supported(SELL, SELL_KERNEL_AVX2)) {
+		return SELL_KERNEL_AVX2;
+	}
+	return SELL_KERNEL_SCALAR;
+}
+
+
+void spmv_SELL(const SellMatrix *SELL, const double *x, double *y) {
+
+	spmv_SELL_kernel(SELL, x, y, SELL_KERNEL_AUTO);
+}
+
+
+void spmv_SELL_kernel(const SellMatrix *SELL, const double *x, double *y, SellKernel kernel) {
+
+	INSTRUMENT_BEGIN();
+
+	if ((kernel == SELL_KERNEL_AUTO) || !SELL_kernel_supported(SELL, kernel)) {
+		kernel = (kernel == SELL_KERNEL_AUTO) ? select_SELL_kernel(SELL) : SELL_KERNEL_SCALAR;
+	}
+
+	switch (kernel) {
+#ifdef SELL_X86_KERNELS
+	case SELL_KERNEL_AVX512:
+		spmv_SELL_avx512(SELL, x, y);
+		break;
+	case SELL_KERNEL_AVX2:
+		spmv_SELL_avx2(SELL, x, y);
+		break;
+#endif
+	default:
+		spmv_SELL_scalar(SELL, x, y);
+		break;
+	}
+
+	INSTRUMENT_END(OP_SPMV_SELL, (uint64_t)SELL->slice_ptr[SELL->nslices] * (INDEX_SIZE + DOUBLE_SIZE) + VECTOR_BYTES(SELL->nr, SELL->nc), SELL->nnz);
+}
+
+
+void deallocate_SELL_matrix(SellMatrix *SELL) {
+
+	free(SELL->slice_ptr);
+	free(SELL->perm);
+	free(SELL->ja);
+	free(SELL->a);
+}
@@ -0,0 +1,366 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "spgemm.h"
+#include "instrument.h"
+
+
+//Hash of a column index into a table of mask + 1 entries (a power of two)
+#define HASH_SLOT(col, mask) 	((index_t)(((uint64_t)(col) * 2654435761u) & (uint64_t)(mask)))
+
+
+//Smallest power of two holding twice n entries, so that the tables are at most half full
+static index_t hash_table_size(index_t n) {
+
+	index_t size = 1;
+	while (size < 2 * n) {
+		size <<= 1;
+	}
+	return size;
+}
+
+
+//Upper bound of the number of entries of row i of A*B: the number of products, capped by nc
+static index_t row_product_bound(const SparseMatrix *A, const SparseMatrix *B, index_t i) {
+
+	int64_t flops = 0;
+	for (index_t j = A->ia[i]; j < A->ia[i + 1]; j++) {
+		index_t k = A->ja[j];
+		flops += B->ia[k + 1] - B->ia[k];
+	}
+	return (flops < B->nc) ? (index_t)flops : B->nc;
+}
+
+
+static int check_dimensions(const SparseMatrix *A, const SparseMatrix *B) {
+
+	if (A->nc != B->nr) {
+		fprintf(stderr, "SpGEMM: cannot multiply a " INDEX_FMT " x " INDEX_FMT " matrix by a " INDEX_FMT " x " INDEX_FMT " one.\n",
+				A->nr, A->nc, B->nr, B->nc);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * The symbolic phase makes two passes over the rows. The first one counts the distinct columns
+ * of every row of C, which gives the row pointers and the exact size of C; the second one, after
+ * the single allocation, writes the columns and sorts them. The rows are scheduled dynamically
+ * since their cost varies with the lengths of the rows of B they touch.*/
+int spgemm_symbolic(const SparseMatrix *A, const SparseMatrix *B, SparseMatrix *C) {
+
+	INSTRUMENT_BEGIN();
+
+	if (check_dimensions(A, B) != 0) {
+		return -1;
+	}
+
+	index_t nr 			= A->nr;
+	index_t nc 			= B->nc;
+	index_t *bound 		= malloc((size_t)nr * INDEX_SIZE);
+	index_t *row_nnz 	= malloc(((size_t)nr + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(bound);
+	IS_POINTER_VALID(row_nnz);
+
+	//Step 1: size bound of every row, which selects its accumulator and sizes the hash tables
+	index_t max_hash_bound = 0;
+
+	#pragma omp parallel for reduction(max:max_hash_bound) if (A->nnz > PARALLEL_NNZ_THRESHOLD)
+	for (index_t i = 0; i < nr; i++) {
+		bound[i] = row_product_bound(A, B, i);
+		if ((bound[i] <= nc / SPGEMM_DENSE_RATIO) && (bound[i] > max_hash_bound)) {
+			max_hash_bound = bound[i];
+		}
+	}
+
+	index_t table_size 	= hash_table_size(max_hash_bound);
+	int64_t total 		= 0;
+
+	//Step 2: count the distinct columns of every row
+	#pragma omp parallel reduction(+:total) if (A->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		index_t *keys 	= malloc((size_t)table_size * INDEX_SIZE);
+		index_t *marker = NULL;
+		IS_POINTER_VALID(keys);
+
+		#pragma omp for schedule(dynamic, 64)
+		for (index_t i = 0; i < nr; i++) {
+
+			index_t count = 0;
+
+			if (bound[i] > nc / SPGEMM_DENSE_RATIO) {
+
+				//Dense accumulator: marker[col] holds the last row that contained col
+				if (marker == NULL) {
+					marker = malloc((size_t)nc * INDEX_SIZE);
+					IS_POINTER_VALID(marker);
+					memset(marker, 0xff, (size_t)nc * INDEX_SIZE);
+				}
+
+				for (index_t j = A->ia[i]; j < A->ia[i + 1]; j++) {
+					index_t k = A->ja[j];
+					for (index_t l = B->ia[k]; l < B->ia[k + 1]; l++) {
+						if (marker[B->ja[l]] != i) {
+							marker[B->ja[l]] = i;
+							count++;
+						}
+					}
+				}
+			}
+			else {
+
+				//Hash accumulator with linear probing; empty slots hold -1
+				index_t mask = hash_table_size(bound[i]) - 1;
+				memset(keys, 0xff, ((size_t)mask + 1) * INDEX_SIZE);
+
+				for (index_t j = A->ia[i]; j < A->ia[i + 1]; j++) {
+					index_t k = A->ja[j];
+					for (index_t l = B->ia[k]; l < B->ia[k + 1]; l++) {
+						index_t col 	= B->ja[l];
+						index_t slot 	= HASH_SLOT(col, mask);
+						while ((keys[slot] != -1) && (keys[slot] != col)) {
+							slot = (slot + 1) & mask;
+						}
+						if (keys[slot] == -1) {
+							keys[slot] = col;
+							count++;
+						}
+					}
+				}
+			}
+
+			row_nnz[i] 	= count;
+			total 		+= count;
+		}
+
+		free(keys);
+		free(marker);
+	}
+
+	if (total > INDEX_MAX) {
+		fprintf(stderr, "SpGEMM: the product has too many entries for the index type.\n");
+		free(bound);
+		free(row_nnz);
+		return -1;
+	}
+
+	//Step 3: allocate C once, with the row pointers from a prefix sum of the row counts
+	row_nnz[nr] = 0;
+	parallel_exclusive_scan(row_nnz, nr + 1);
+
+	C->nr 	= nr;
+	C->nc 	= nc;
+	C->nnz 	= (index_t)total;
+	reset_matrix_storage(C);
+	reserve_CSR_matrix(C, 0);
+	memcpy(C->ia, row_nnz, ((size_t)nr + 1) * INDEX_SIZE);
+	free(row_nnz);
+
+	//Step 4: write the columns of every row, then sort them
+	#pragma omp parallel if (A->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		index_t *keys 	= malloc((size_t)table_size * INDEX_SIZE);
+		index_t *marker = NULL;
+		IS_POINTER_VALID(keys);
+
+		#pragma omp for schedule(dynamic, 64)
+		for (index_t i = 0; i < nr; i++) {
+
+			index_t pos = C->ia[i];
+
+			if (bound[i] > nc / SPGEMM_DENSE_RATIO) {
+
+				if (marker == NULL) {
+					marker = malloc((size_t)nc * INDEX_SIZE);
+					IS_POINTER_VALID(marker);
+					memset(marker, 0xff, (size_t)nc * INDEX_SIZE);
+				}
+
+				for (index_t j = A->ia[i]; j < A->ia[i + 1]; j++) {
+					index_t k = A->ja[j];
+					for (index_t l = B->ia[k]; l < B->ia[k + 1]; l++) {
+						if (marker[B->ja[l]] != i) {
+							marker[B->ja[l]] 	= i;
+							C->ja[pos++] 		= B->ja[l];
+						}
+					}
+				}
+			}
+			else {
+
+				index_t mask = hash_table_size(bound[i]) - 1;
+				memset(keys, 0xff, ((size_t)mask + 1) * INDEX_SIZE);
+
+				for (index_t j = A->ia[i]; j < A->ia[i + 1]; j++) {
+					index_t k = A->ja[j];
+					for (index_t l = B->ia[k]; l < B->ia[k + 1]; l++) {
+						index_t col 	= B->ja[l];
+						index_t slot 	= HASH_SLOT(col, mask);
+						while ((keys[slot] != -1) && (keys[slot] != col)) {
+							slot = (slot + 1) & mask;
+						}
+						if (keys[slot] == -1) {
+							keys[slot] 		= col;
+							C->ja[pos++] 	= col;
+						}
+					}
+				}
+			}
+
+			//The values are not computed yet: their storage serves as scratch for the sort
+			sort_row_by_column(C->ja + C->ia[i], C->a + C->ia[i], C->ia[i + 1] - C->ia[i]);
+		}
+
+		free(keys);
+		free(marker);
+	}
+
+	free(bound);
+
+	INSTRUMENT_END(OP_SPGEMM_SYMBOLIC, COMPRESSED_BYTES(A->nr, A->nnz) + COMPRESSED_BYTES(B->nr, B->nnz) + COMPRESSED_BYTES(C->nr, C->nnz), C->nnz);
+	return 0;
+}
+
+
+/**
+ * With the pattern of C known, each row maps its columns to their positions in C, either in a
+ * dense array or in a hash table, and the products are accumulated directly into C->a.*/
+int spgemm_numeric(const SparseMatrix *A, const SparseMatrix *B, SparseMatrix *C) {
+
+	INSTRUMENT_BEGIN();
+
+	if (check_dimensions(A, B) != 0) {
+		return -1;
+	}
+	if ((C->nr != A->nr) || (C->nc != B->nc)) {
+		fprintf(stderr, "SpGEMM: the output does not come from the symbolic phase of this product.\n");
+		return -1;
+	}
+
+	index_t nr = A->nr;
+	index_t nc = B->nc;
+
+	//The hash tables are sized by the longest row of C that does not use the dense accumulator
+	index_t max_hash_len = 0;
+	for (index_t i = 0; i < nr; i++) {
+		index_t len = C->ia[i + 1] - C->ia[i];
+		if ((len <= nc / SPGEMM_DENSE_RATIO) && (len > max_hash_len)) {
+			max_hash_len = len;
+		}
+	}
+	index_t table_size = hash_table_size(max_hash_len);
+
+	#pragma omp parallel if (A->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		index_t *keys 		= malloc((size_t)table_size * INDEX_SIZE);
+		index_t *position 	= malloc((size_t)table_size * INDEX_SIZE);
+		index_t *dense 		= NULL;
+		IS_POINTER_VALID(keys);
+		IS_POINTER_VALID(position);
+
+		#pragma omp for schedule(dynamic, 64)
+		for (index_t i = 0; i < nr; i++) {
+
+			index_t begin 	= C->ia[i];
+			index_t end 	= C->ia[i + 1];
+			index_t len 	= end - begin;
+
+			memset(C->a + begin, 0, (size_t)len * DOUBLE_SIZE);
+
+			if (len > nc / SPGEMM_DENSE_RATIO) {
+
+				//Dense accumulator: dense[col] is the position of col in C, set for this row only
+				if (dense == NULL) {
+					dense = malloc((size_t)nc * INDEX_SIZE);
+					IS_POINTER_VALID(dense);
+				}
+				for (index_t p = begin; p < end; p++) {
+					dense[C->ja[p]] = p;
+				}
+
+				for (index_t j = A->ia[i]; j < A->ia[i + 1]; j++) {
+					index_t k 	= A->ja[j];
+					double 	val = A->a[j];
+					for (index_t l = B->ia[k]; l < B->ia[k + 1]; l++) {
+						C->a[dense[B->ja[l]]] += val * B->a[l];
+					}
+				}
+			}
+			else {
+
+				index_t mask = hash_table_size(len) - 1;
+				memset(keys, 0xff, ((size_t)mask + 1) * INDEX_SIZE);
+
+				for (index_t p = begin; p < end; p++) {
+					index_t slot = HASH_SLOT(C->ja[p], mask);
+					while (keys[slot] != -1) {
+						slot = (slot + 1) & mask;
+					}
+					keys[slot] 		= C->ja[p];
+					position[slot] 	= p;
+				}
+
+				for (index_t j = A->ia[i]; j < A->ia[i + 1]; j++) {
+					index_t k 	= A->ja[j];
+					double 	val = A->a[j];
+					for (index_t l = B->ia[k]; l < B->ia[k + 1]; l++) {
+						index_t col 	= B->ja[l];
+						index_t slot 	= HASH_SLOT(col, mask);
+						while (keys[slot] != col) {
+							slot = (slot + 1) & mask;
+						}
+						C->a[position[slot]] += val * B->a[l];
+					}
+				}
+			}
+		}
+
+		free(keys);
+		free(position);
+		free(dense);
+	}
+
+	INSTRUMENT_END(OP_SPGEMM_NUMERIC, COMPRESSED_BYTES(A->nr, A->nnz) + COMPRESSED_BYTES(B->nr, B->nnz) + COMPRESSED_BYTES(C->nr, C->nnz), C->nnz);
+	return 0;
+}
+
+
+int spgemm(const SparseMatrix *A, const SparseMatrix *B, SparseMatrix *C) {
+
+	if (spgemm_symbolic(A, B, C) != 0) {
+		return -1;
+	}
+	return spgemm_numeric(A, B, C);
+}
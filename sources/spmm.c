@@ -0,0 +1,267 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "spmm.h"
+#include "instrument.h"
+
+
+/**
+ * Kernels for a tile of K vectors over the rows [row_begin, row_end). K is a compile-time
+ * constant, so the K sums of a row stay in registers and the loops over the vectors are
+ * unrolled and vectorized. The row-major kernel reads K contiguous values of X per entry;
+ * the column-major one reads them with a stride of ldx.*/
+#define DEFINE_SPMM_KERNELS(K) 																		\
+static void spmm_row_major_##K(const SparseMatrix *CSR, const double *X, index_t ldx, 				\
+							   double *Y, index_t ldy, index_t row_begin, index_t row_end) { 		\
+																									\
+	const index_t 	*ia = CSR->ia; 																	\
+	const index_t 	*ja = CSR->ja; 																	\
+	const double 	*a 	= CSR->a; 																	\
+																									\
+	for (index_t i = row_begin; i < row_end; i++) { 												\
+																									\
+		double sum[K]; 																				\
+		_Pragma("GCC unroll 16") 																	\
+		for (int v = 0; v < K; v++) { 																\
+			sum[v] = 0.0; 																			\
+		} 																							\
+		for (index_t j = ia[i]; j < ia[i + 1]; j++) { 												\
+			const double 	*x 	= X + (size_t)ja[j] * ldx; 											\
+			double 			aij = a[j]; 															\
+			_Pragma("GCC unroll 16") 																\
+			for (int v = 0; v < K; v++) { 															\
+				sum[v] += aij * x[v]; 																\
+			} 																						\
+		} 																							\
+																									\
+		double *y = Y + (size_t)i * ldy; 															\
+		_Pragma("GCC unroll 16") 																	\
+		for (int v = 0; v < K; v++) { 																\
+			y[v] = sum[v]; 																			\
+		} 																							\
+	} 																								\
+} 																									\
+																									\
+static void spmm_col_major_##K(const SparseMatrix *CSR, const double *X, index_t ldx, 				\
+							   double *Y, index_t ldy, index_t row_begin, index_t row_end) { 		\
+																									\
+	const index_t 	*ia = CSR->ia; 																	\
+	const index_t 	*ja = CSR->ja; 																	\
+	const double 	*a 	= CSR->a; 																	\
+																									\
+	for (index_t i = row_begin; i < row_end; i++) { 												\
+																									\
+		double sum[K]; 																				\
+		_Pragma("GCC unroll 16") 																	\
+		for (int v = 0; v < K; v++) { 																\
+			sum[v] = 0.0; 																			\
+		} 																							\
+		for (index_t j = ia[i]; j < ia[i + 1]; j++) { 												\
+			const double 	*x 	= X + ja[j]; 														\
+			double 			aij = a[j]; 															\
+			_Pragma("GCC unroll 16") 																\
+			for (int v = 0; v < K; v++) { 															\
+				sum[v] += aij * x[(size_t)v * ldx]; 												\
+			} 																						\
+		} 																							\
+																									\
+		_Pragma("GCC unroll 16") 																	\
+		for (int v = 0; v < K; v++) { 																\
+			Y[(size_t)v * ldy + i] = sum[v]; 														\
+		} 																							\
+	} 																								\
+}
+
+DEFINE_SPMM_KERNELS(1)
+DEFINE_SPMM_KERNELS(2)
+DEFINE_SPMM_KERNELS(4)
+DEFINE_SPMM_KERNELS(8)
+DEFINE_SPMM_KERNELS(16)
+
+#undef DEFINE_SPMM_KERNELS
+
+
+/**
+ * Kernels for the last tile, of width vectors with 0 < width < 16, in a single pass over
+ * the rows. The 16 sums are split into fixed groups of 8, 4, 2 and 1 lanes (at 0, 8, 12
+ * and 14), and the bits of width mask the groups in: a group of 2^b lanes covers the
+ * vectors from (width & ~(2^(b+1) - 1)), so every sum keeps a constant index and stays
+ * in a register, and the tests on width are the same for every entry.*/
+#define TAIL_GROUPS(GROUP) 				\
+	GROUP(8, 0, 0) 						\
+	GROUP(4, 8, width & 8) 				\
+	GROUP(2, 12, width & 12) 			\
+	GROUP(1, 14, width & 14)
+
+static void spmm_row_major_tail(const SparseMatrix *CSR, const double *X, index_t ldx,
+								double *Y, index_t ldy, index_t row_begin, index_t row_end, int width) {
+
+	const index_t 	*ia = CSR->ia;
+	const index_t 	*ja = CSR->ja;
+	const double 	*a 	= CSR->a;
+
+	for (index_t i = row_begin; i < row_end; i++) {
+
+		double sum[16];
+		_Pragma("GCC unroll 16")
+		for (int v = 0; v < 16; v++) {
+			sum[v] = 0.0;
+		}
+		for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+			const double 	*x 	= X + (size_t)ja[j] * ldx;
+			double 			aij = a[j];
+
+			#define GROUP(LANES, LANE, FIRST) 											\
+			if (width & LANES) { 														\
+				_Pragma("GCC unroll 8") 												\
+				for (int v = 0; v < LANES; v++) { 										\
+					sum[LANE + v] += aij * x[(FIRST) + v]; 								\
+				} 																		\
+			}
+			TAIL_GROUPS(GROUP)
+			#undef GROUP
+		}
+
+		double *y = Y + (size_t)i * ldy;
+		#define GROUP(LANES, LANE, FIRST) 												\
+		if (width & LANES) { 															\
+			_Pragma("GCC unroll 8") 													\
+			for (int v = 0; v < LANES; v++) { 											\
+				y[(FIRST) + v] = sum[LANE + v]; 										\
+			} 																			\
+		}
+		TAIL_GROUPS(GROUP)
+		#undef GROUP
+	}
+}
+
+
+static void spmm_col_major_tail(const SparseMatrix *CSR, const double *X, index_t ldx,
+								double *Y, index_t ldy, index_t row_begin, index_t row_end, int width) {
+
+	const index_t 	*ia = CSR->ia;
+	const index_t 	*ja = CSR->ja;
+	const double 	*a 	= CSR->a;
+
+	for (index_t i = row_begin; i < row_end; i++) {
+
+		double sum[16];
+		_Pragma("GCC unroll 16")
+		for (int v = 0; v < 16; v++) {
+			sum[v] = 0.0;
+		}
+		for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+			const double 	*x 	= X + ja[j];
+			double 			aij = a[j];
+
+			#define GROUP(LANES, LANE, FIRST) 											\
+			if (width & LANES) { 														\
+				_Pragma("GCC unroll 8") 												\
+				for (int v = 0; v < LANES; v++) { 										\
+					sum[LANE + v] += aij * x[(size_t)((FIRST) + v) * ldx]; 			\
+				} 																		\
+			}
+			TAIL_GROUPS(GROUP)
+			#undef GROUP
+		}
+
+		#define GROUP(LANES, LANE, FIRST) 												\
+		if (width & LANES) { 															\
+			_Pragma("GCC unroll 8") 													\
+			for (int v = 0; v < LANES; v++) { 											\
+				Y[(size_t)((FIRST) + v) * ldy + i] = sum[LANE + v]; 					\
+			} 																			\
+		}
+		TAIL_GROUPS(GROUP)
+		#undef GROUP
+	}
+}
+
+#undef TAIL_GROUPS
+
+
+typedef void (*SpmmKernel)(const SparseMatrix *CSR, const double *X, index_t ldx, double *Y, index_t ldy,
+						   index_t row_begin, index_t row_end);
+
+//Last tiles whose width is a power of two need no mask; their kernels are indexed by log2(width)
+static const SpmmKernel 	row_major_kernel[] 	= {spmm_row_major_1, spmm_row_major_2, spmm_row_major_4, spmm_row_major_8};
+static const SpmmKernel 	col_major_kernel[] 	= {spmm_col_major_1, spmm_col_major_2, spmm_col_major_4, spmm_col_major_8};
+
+
+void spmm_CSR(const SparseMatrix *CSR, DenseLayout layout, index_t k, const double *X, index_t ldx, double *Y, index_t ldy) {
+
+	INSTRUMENT_BEGIN();
+
+	#pragma omp parallel if ((int64_t)CSR->nnz * k > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+
+		index_t row_begin 	= nnz_balanced_row_split(CSR->ia, CSR->nr, tid, nthreads);
+		index_t row_end 	= nnz_balanced_row_split(CSR->ia, CSR->nr, tid + 1, nthreads);
+
+		//Every thread runs the tiles over its own rows, which stay in cache between tiles when they fit
+		index_t v = 0;
+		for (; v + 16 <= k; v += 16) {
+			if (layout == LAYOUT_ROW_MAJOR) {
+				spmm_row_major_16(CSR, X + v, ldx, Y + v, ldy, row_begin, row_end);
+			}
+			else {
+				spmm_col_major_16(CSR, X + (size_t)v * ldx, ldx, Y + (size_t)v * ldy, ldy, row_begin, row_end);
+			}
+		}
+
+		//The remaining vectors, fewer than 16, take one more pass
+		int width = (int)(k - v);
+		if ((width > 0) && ((width & (width - 1)) == 0)) {
+			int t = __builtin_ctz(width);
+			if (layout == LAYOUT_ROW_MAJOR) {
+				row_major_kernel[t](CSR, X + v, ldx, Y + v, ldy, row_begin, row_end);
+			}
+			else {
+				col_major_kernel[t](CSR, X + (size_t)v * ldx, ldx, Y + (size_t)v * ldy, ldy, row_begin, row_end);
+			}
+		}
+		else if (width > 0) {
+			if (layout == LAYOUT_ROW_MAJOR) {
+				spmm_row_major_tail(CSR, X + v, ldx, Y + v, ldy, row_begin, row_end, width);
+			}
+			else {
+				spmm_col_major_tail(CSR, X + (size_t)v * ldx, ldx, Y + (size_t)v * ldy, ldy, row_begin, row_end, width);
+			}
+		}
+	}
+
+	INSTRUMENT_END(OP_SPMM_CSR, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + (uint64_t)k * VECTOR_BYTES(CSR->nr, CSR->nc), (uint64_t)CSR->nnz * k);
+}
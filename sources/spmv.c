@@ -0,0 +1,135 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "spmv.h"
+#include "instrument.h"
+
+
+void spmv_CSR(const SparseMatrix *CSR, const double *x, double *y) {
+
+	spmv_CSR_axpby(1.0, CSR, x, 0.0, y);
+}
+
+
+void spmv_CSR_axpby(double alpha, const SparseMatrix *CSR, const double *x, double beta, double *y) {
+
+	INSTRUMENT_BEGIN();
+
+	const index_t 	*ia = CSR->ia;
+	const index_t 	*ja = CSR->ja;
+	const double 	*a 	= CSR->a;
+
+	#pragma omp parallel if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+
+		//Every thread computes its own row range from ia, so no partition array is needed
+		index_t row_begin 	= nnz_balanced_row_split(ia, CSR->nr, tid, nthreads);
+		index_t row_end 	= nnz_balanced_row_split(ia, CSR->nr, tid + 1, nthreads);
+
+		for (index_t i = row_begin; i < row_end; i++) {
+
+			double sum = 0.0;
+			for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+				sum += a[j] * x[ja[j]];
+			}
+
+			//beta = 0 must not propagate NaN or Inf values already stored in y
+			y[i] = (beta == 0.0) ? alpha * sum : alpha * sum + beta * y[i];
+		}
+	}
+
+	INSTRUMENT_END(OP_SPMV_CSR, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + VECTOR_BYTES(CSR->nr, CSR->nc), CSR->nnz);
+}
+
+
+void spmv_CSR_merge_path(const SparseMatrix *CSR, const double *x, double *y) {
+
+	INSTRUMENT_BEGIN();
+
+	const index_t 	*ia = CSR->ia;
+	const index_t 	*ja = CSR->ja;
+	const double 	*a 	= CSR->a;
+
+	int 	max_threads = get_max_threads();
+	int 	team_size 	= 1;
+	index_t carry_row[max_threads];
+	double 	carry_val[max_threads];
+
+	#pragma omp parallel num_threads(max_threads) if (CSR->nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+		if (tid == 0) {
+			team_size = nthreads;
+		}
+
+		//Each thread consumes the same number of merge items (row ends + nonzero entries)
+		int64_t total 		= (int64_t)CSR->nr + CSR->nnz;
+		int64_t diag_begin 	= total * tid / nthreads;
+		int64_t diag_end 	= total * (tid + 1) / nthreads;
+
+		index_t row, nz, row_end, nz_end;
+		merge_path_search(ia, CSR->nr, CSR->nnz, diag_begin, &row, &nz);
+		merge_path_search(ia, CSR->nr, CSR->nnz, diag_end, &row_end, &nz_end);
+
+		//Rows completed by this thread
+		double sum = 0.0;
+		for ( ; row < row_end; row++) {
+			for ( ; nz < ia[row + 1]; nz++) {
+				sum += a[nz] * x[ja[nz]];
+			}
+			y[row] 	= sum;
+			sum 	= 0.0;
+		}
+
+		//Partial sum of the row that continues in the next thread
+		for ( ; nz < nz_end; nz++) {
+			sum += a[nz] * x[ja[nz]];
+		}
+
+		carry_row[tid] = row_end;
+		carry_val[tid] = sum;
+	}
+
+	//Fix-up: add the partial sums of the rows shared between threads
+	for (int t = 0; t < team_size - 1; t++) {
+		if (carry_row[t] < CSR->nr) {
+			y[carry_row[t]] += carry_val[t];
+		}
+	}
+
+	INSTRUMENT_END(OP_SPMV_CSR_MERGE_PATH, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + VECTOR_BYTES(CSR->nr, CSR->nc), CSR->nnz);
+}
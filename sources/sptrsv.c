@@ -0,0 +1,183 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "sptrsv.h"
+#include "instrument.h"
+
+
+int sptrsv_analysis(const SparseMatrix *CSR, TriangleType uplo, int unit_diagonal, TriangularSchedule *schedule) {
+
+	INSTRUMENT_BEGIN();
+
+	index_t n = CSR->nr;
+
+	if (CSR->nr != CSR->nc) {
+		fprintf(stderr, "Triangular solve: the matrix is not square.\n");
+		return -1;
+	}
+
+	index_t *level 	= malloc((size_t)n * INDEX_SIZE);
+	index_t *diag 	= malloc((size_t)n * INDEX_SIZE);
+	IS_POINTER_VALID(level);
+	IS_POINTER_VALID(diag);
+
+	//Step 1: level of every row, visiting the rows in dependency order
+	index_t nlevels = 0;
+	int valid 		= 1;
+
+	for (index_t r = 0; valid && (r < n); r++) {
+
+		index_t i 	= (uplo == TRIANGLE_LOWER) ? r : n - 1 - r;
+		index_t lev = 0;
+		diag[i] 	= -1;
+
+		for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+
+			index_t col = CSR->ja[j];
+			if (col == i) {
+				diag[i] = j;
+			}
+			else if ((uplo == TRIANGLE_LOWER) == (col < i)) {
+				lev = (level[col] + 1 > lev) ? level[col] + 1 : lev;
+			}
+			else {
+				valid = 0;
+			}
+		}
+
+		level[i] 	= lev;
+		nlevels 	= (lev + 1 > nlevels) ? lev + 1 : nlevels;
+		valid 		= valid && (unit_diagonal || (diag[i] >= 0));
+	}
+
+	if (!valid) {
+		fprintf(stderr, "Triangular solve: the matrix is not %s triangular%s.\n",
+				(uplo == TRIANGLE_LOWER) ? "lower" : "upper", unit_diagonal ? "" : " with a full diagonal");
+		free(level);
+		free(diag);
+		return -1;
+	}
+
+	//Step 2: group the rows by level with a counting sort, which keeps them in increasing order
+	index_t *level_ptr 	= calloc((size_t)nlevels + 1, INDEX_SIZE);
+	index_t *level_rows = malloc((size_t)n * INDEX_SIZE);
+	IS_POINTER_VALID(level_ptr);
+	IS_POINTER_VALID(level_rows);
+
+	for (index_t i = 0; i < n; i++) {
+		level_ptr[level[i] + 1]++;
+	}
+	for (index_t l = 0; l < nlevels; l++) {
+		level_ptr[l + 1] += level_ptr[l];
+	}
+	for (index_t i = 0; i < n; i++) {
+		level_rows[level_ptr[level[i]]++] = i;
+	}
+	for (index_t l = nlevels; l > 0; l--) {
+		level_ptr[l] = level_ptr[l - 1];
+	}
+	level_ptr[0] = 0;
+
+	free(level);
+
+	schedule->n 			= n;
+	schedule->uplo 			= uplo;
+	schedule->unit_diagonal = unit_diagonal;
+	schedule->nlevels 		= nlevels;
+	schedule->level_ptr 	= level_ptr;
+	schedule->level_rows 	= level_rows;
+	schedule->diag 			= diag;
+
+	INSTRUMENT_END(OP_SPTRSV_ANALYSIS, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + 3 * (uint64_t)n * INDEX_SIZE, CSR->nnz);
+	return 0;
+}
+
+
+//Solves row i, whose dependencies are all solved
+static inline void solve_row(const SparseMatrix *CSR, const TriangularSchedule *schedule, const double *b, double *x, index_t i) {
+
+	index_t d 	= schedule->diag[i];
+	double sum 	= b[i];
+
+	for (index_t j = CSR->ia[i]; j < CSR->ia[i + 1]; j++) {
+		if (j != d) {
+			sum -= CSR->a[j] * x[CSR->ja[j]];
+		}
+	}
+	x[i] = schedule->unit_diagonal ? sum : sum / CSR->a[d];
+}
+
+
+/**
+ * The levels are processed in order, and the implicit barrier at the end of each worksharing
+ * loop makes the solutions of a level visible to the next one. Long chains of narrow levels
+ * would spend more time in barriers than in arithmetic, so they are solved serially.*/
+void sptrsv_solve(const SparseMatrix *CSR, const TriangularSchedule *schedule, const double *b, double *x) {
+
+	INSTRUMENT_BEGIN();
+
+	index_t n = schedule->n;
+
+	int parallel = (CSR->nnz > PARALLEL_NNZ_THRESHOLD) && (get_max_threads() > 1) &&
+				   (n >= (int64_t)SPTRSV_MIN_LEVEL_WIDTH * schedule->nlevels);
+
+	if (!parallel) {
+		for (index_t r = 0; r < n; r++) {
+			solve_row(CSR, schedule, b, x, (schedule->uplo == TRIANGLE_LOWER) ? r : n - 1 - r);
+		}
+		INSTRUMENT_END(OP_SPTRSV_SOLVE, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + 2 * (uint64_t)n * DOUBLE_SIZE, CSR->nnz);
+		return;
+	}
+
+	#pragma omp parallel
+	{
+		for (index_t l = 0; l < schedule->nlevels; l++) {
+
+			#pragma omp for schedule(static)
+			for (index_t k = schedule->level_ptr[l]; k < schedule->level_ptr[l + 1]; k++) {
+				solve_row(CSR, schedule, b, x, schedule->level_rows[k]);
+			}
+		}
+	}
+
+	INSTRUMENT_END(OP_SPTRSV_SOLVE, COMPRESSED_BYTES(CSR->nr, CSR->nnz) + 2 * (uint64_t)n * DOUBLE_SIZE, CSR->nnz);
+}
+
+
+void deallocate_triangular_schedule(TriangularSchedule *schedule) {
+
+	free(schedule->level_ptr);
+	free(schedule->level_rows);
+	free(schedule->diag);
+}
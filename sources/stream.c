@@ -0,0 +1,737 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "stream.h"
+#include "spmv.h"
+#include "instrument.h"
+
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//Reads len bytes at offset, resuming after partial reads
+static int pread_full(int fd, void *buf, size_t len, off_t offset) {
+
+	char *p = (char *)buf;
+	while (len > 0) {
+		ssize_t n = pread(fd, p, len, offset);
+		if ((n < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		p 		+= n;
+		len 	-= n;
+		offset 	+= n;
+	}
+	return 0;
+}
+
+
+static int pwrite_full(int fd, const void *buf, size_t len, off_t offset) {
+
+	const char *p = (const char *)buf;
+	while (len > 0) {
+		ssize_t n = pwrite(fd, p, len, offset);
+		if ((n < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		p 		+= n;
+		len 	-= n;
+		offset 	+= n;
+	}
+	return 0;
+}
+
+
+/**
+ * Splits [0, n) into consecutive ranges, each one as long as possible while its items and
+ * their entries (ptr[end] - ptr[begin]) take at most limit bytes.
+ * Stores the first item of every range in range_ptr, if not NULL, followed by n.
+ * @return	the number of ranges, or -1 if a single item does not fit.*/
+static index_t split_ranges(const index_t *ptr, index_t n, size_t item_bytes, size_t entry_bytes, size_t limit, index_t *range_ptr) {
+
+	#define RANGE_BYTES(items, entries) 	(((size_t)(items) + 1) * item_bytes + (size_t)(entries) * entry_bytes)
+
+	index_t nranges = 0;
+	index_t begin 	= 0;
+
+	while (begin < n) {
+		index_t end = begin;
+		while ((end < n) && (RANGE_BYTES(end + 1 - begin, ptr[end + 1] - ptr[begin]) <= limit)) {
+			end++;
+		}
+		if (end == begin) {
+			return -1;
+		}
+		if (range_ptr) {
+			range_ptr[nranges] = begin;
+		}
+		nranges++;
+		begin = end;
+	}
+	if (range_ptr) {
+		range_ptr[nranges] = n;
+	}
+
+	#undef RANGE_BYTES
+
+	return nranges;
+}
+
+
+int open_streamed_matrix(const char *filename, size_t budget, StreamedMatrix *S) {
+
+	memset(S, 0, sizeof(StreamedMatrix));
+
+	S->fd = open(filename, O_RDONLY);
+	if (S->fd < 0) {
+		fprintf(stderr, "Cannot open '%s'.\n", filename);
+		return -1;
+	}
+
+	struct stat st;
+	if ((fstat(S->fd, &st) != 0) || (pread_full(S->fd, &S->header, sizeof(BinaryHeader), 0) != 0) ||
+		(validate_binary_header(&S->header, st.st_size) != 0) || (S->header.format != FORMAT_CSR)) {
+		fprintf(stderr, "'%s' is not a valid CSR binary matrix file.\n", filename);
+		close(S->fd);
+		return -1;
+	}
+
+	S->nr 		= (index_t)S->header.nr;
+	S->nc 		= (index_t)S->header.nc;
+	S->nnz 		= (index_t)S->header.nnz;
+	S->budget 	= budget;
+
+	S->ia = malloc(((size_t)S->nr + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(S->ia);
+
+	if (pread_full(S->fd, S->ia, ((size_t)S->nr + 1) * INDEX_SIZE, S->header.ia_offset) != 0) {
+		fprintf(stderr, "Cannot read the row pointers of '%s'.\n", filename);
+		close_streamed_matrix(S);
+		return -1;
+	}
+
+	//The panels are planned from the row pointers, which must run from 0 to nnz without decreasing
+	int valid = (binary_checksum(BINARY_CHECKSUM_SEED, S->ia, ((size_t)S->nr + 1) * INDEX_SIZE) == S->header.ia_checksum) &&
+				(S->ia[0] == 0) && (S->ia[S->nr] == S->nnz);
+	for (index_t i = 0; valid && (i < S->nr); i++) {
+		valid = (S->ia[i] <= S->ia[i + 1]);
+	}
+	if (!valid) {
+		fprintf(stderr, "Invalid row pointers in '%s'.\n", filename);
+		close_streamed_matrix(S);
+		return -1;
+	}
+
+	//Two panel buffers share half of the budget
+	size_t buffer_bytes = budget / 4;
+	S->npanels = split_ranges(S->ia, S->nr, INDEX_SIZE, INDEX_SIZE + DOUBLE_SIZE, buffer_bytes, NULL);
+	if (S->npanels < 0) {
+		fprintf(stderr, "'%s' has rows too long for a memory budget of %zu bytes.\n", filename, budget);
+		close_streamed_matrix(S);
+		return -1;
+	}
+
+	S->panel_ptr = malloc(((size_t)S->npanels + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(S->panel_ptr);
+	split_ranges(S->ia, S->nr, INDEX_SIZE, INDEX_SIZE + DOUBLE_SIZE, buffer_bytes, S->panel_ptr);
+
+	for (index_t p = 0; p < S->npanels; p++) {
+		index_t rows 	= S->panel_ptr[p + 1] - S->panel_ptr[p];
+		index_t nnz 	= S->ia[S->panel_ptr[p + 1]] - S->ia[S->panel_ptr[p]];
+		S->max_panel_rows 	= (rows > S->max_panel_rows) ? rows : S->max_panel_rows;
+		S->max_panel_nnz 	= (nnz > S->max_panel_nnz) ? nnz : S->max_panel_nnz;
+	}
+	return 0;
+}
+
+
+void close_streamed_matrix(StreamedMatrix *S) {
+
+	if (S->fd >= 0) {
+		close(S->fd);
+	}
+	free(S->ia);
+	free(S->panel_ptr);
+	S->fd 			= -1;
+	S->ia 			= NULL;
+	S->panel_ptr 	= NULL;
+	S->npanels 		= 0;
+}
+
+
+//Panel buffer, with the asynchronous reads of its column indices (0) and values (1)
+typedef struct {
+	index_t 		*ia;
+	index_t 		*ja;
+	double 			*a;
+	SparseMatrix 	panel;
+	index_t 		row_begin;
+	struct aiocb 	cb[2];
+	int 			issued[2];
+} PanelBuffer;
+
+
+//Fills in the row pointers of panel p and starts reading its columns (and values)
+static int start_panel_read(const StreamedMatrix *S, PanelBuffer *buf, index_t p, int need_values) {
+
+	index_t begin 	= S->panel_ptr[p];
+	index_t end 	= S->panel_ptr[p + 1];
+	index_t first 	= S->ia[begin];
+	index_t nnz 	= S->ia[end] - first;
+
+	for (index_t i = begin; i <= end; i++) {
+		buf->ia[i - begin] = S->ia[i] - first;
+	}
+
+	memset(&buf->panel, 0, sizeof(SparseMatrix));
+	buf->panel.nr 	= end - begin;
+	buf->panel.nc 	= S->nc;
+	buf->panel.nnz 	= nnz;
+	buf->panel.ia 	= buf->ia;
+	buf->panel.ja 	= buf->ja;
+	buf->panel.a 	= need_values ? buf->a : NULL;
+	buf->row_begin 	= begin;
+
+	void 	*dest[2] 	= {buf->ja, buf->a};
+	off_t 	offset[2] 	= {S->header.ja_offset + (off_t)first * INDEX_SIZE, S->header.a_offset + (off_t)first * DOUBLE_SIZE};
+	size_t 	len[2] 		= {(size_t)nnz * INDEX_SIZE, (size_t)nnz * DOUBLE_SIZE};
+
+	for (int k = 0; (k < 1 + (need_values != 0)) && (nnz > 0); k++) {
+
+		struct aiocb *cb = &buf->cb[k];
+		memset(cb, 0, sizeof(struct aiocb));
+		cb->aio_fildes 	= S->fd;
+		cb->aio_offset 	= offset[k];
+		cb->aio_buf 	= dest[k];
+		cb->aio_nbytes 	= len[k];
+
+		if (aio_read(cb) == 0) {
+			buf->issued[k] = 1;
+		}
+		//Without AIO resources, the read is synchronous
+		else if (pread_full(S->fd, dest[k], len[k], offset[k]) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+//Checks that the column indices of a panel lie in [0, nc), as the kernels index with them
+static int panel_columns_in_range(const SparseMatrix *panel) {
+
+	for (index_t j = 0; j < panel->nnz; j++) {
+		if ((panel->ja[j] < 0) || (panel->ja[j] >= panel->nc)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+//Waits for the reads of a buffer; a short read is completed synchronously
+static int wait_panel_read(const StreamedMatrix *S, PanelBuffer *buf) {
+
+	int status = 0;
+
+	for (int k = 0; k < 2; k++) {
+
+		if (!buf->issued[k]) {
+			continue;
+		}
+
+		struct aiocb *cb 				= &buf->cb[k];
+		const struct aiocb *list[1] 	= {cb};
+		while (aio_error(cb) == EINPROGRESS) {
+			aio_suspend(list, 1, NULL);
+		}
+
+		ssize_t n = aio_return(cb);
+		if (n < 0) {
+			status = -1;
+		}
+		else if (((size_t)n < cb->aio_nbytes) &&
+				 (pread_full(S->fd, (char *)cb->aio_buf + n, cb->aio_nbytes - n, cb->aio_offset + n) != 0)) {
+			status = -1;
+		}
+		buf->issued[k] = 0;
+	}
+	return status;
+}
+
+
+int stream_row_panels(StreamedMatrix *S, int need_values, PanelKernel kernel, void *arg) {
+
+	PanelBuffer buf[2];
+	memset(buf, 0, sizeof(buf));
+
+	for (int b = 0; b < 2; b++) {
+		buf[b].ia = malloc(((size_t)S->max_panel_rows + 1) * INDEX_SIZE);
+		buf[b].ja = malloc(((size_t)S->max_panel_nnz + 1) * INDEX_SIZE);
+		buf[b].a  = need_values ? malloc(((size_t)S->max_panel_nnz + 1) * DOUBLE_SIZE) : NULL;
+		IS_POINTER_VALID(buf[b].ia);
+		IS_POINTER_VALID(buf[b].ja);
+		if (need_values) {
+			IS_POINTER_VALID(buf[b].a);
+		}
+	}
+
+	int status 	= (S->npanels > 0) ? start_panel_read(S, &buf[0], 0, need_values) : 0;
+	int corrupt = 0;
+
+	for (index_t p = 0; (p < S->npanels) && (status == 0); p++) {
+
+		PanelBuffer *current 	= &buf[p % 2];
+		PanelBuffer *next 		= &buf[(p + 1) % 2];
+
+		status = wait_panel_read(S, current);
+		if ((status == 0) && !panel_columns_in_range(&current->panel)) {
+			fprintf(stderr, "Column index out of range in rows " INDEX_FMT " to " INDEX_FMT " of the streamed matrix.\n",
+					current->row_begin, current->row_begin + current->panel.nr - 1);
+			status 	= -1;
+			corrupt = 1;
+		}
+
+		//The next panel is read while the kernel runs on this one
+		if ((status == 0) && (p + 1 < S->npanels)) {
+			status = start_panel_read(S, next, p + 1, need_values);
+		}
+		if (status == 0) {
+			kernel(&current->panel, current->row_begin, arg);
+		}
+	}
+
+	//No read may be left in flight into the buffers
+	for (int b = 0; b < 2; b++) {
+		wait_panel_read(S, &buf[b]);
+		free(buf[b].ia);
+		free(buf[b].ja);
+		free(buf[b].a);
+	}
+
+	if ((status != 0) && !corrupt) {
+		fprintf(stderr, "Cannot read a row panel of the streamed matrix.\n");
+	}
+	return status;
+}
+
+
+typedef struct {
+	const double 	*x;
+	double 			*y;
+} SpmvArgs;
+
+
+static void spmv_panel(const SparseMatrix *panel, index_t row_begin, void *arg) {
+
+	SpmvArgs *args = (SpmvArgs *)arg;
+	spmv_CSR(panel, args->x, args->y + row_begin);
+}
+
+
+int stream_spmv(StreamedMatrix *S, const double *x, double *y) {
+
+	INSTRUMENT_BEGIN();
+
+	SpmvArgs args = {x, y};
+	int status = stream_row_panels(S, 1, spmv_panel, &args);
+
+	INSTRUMENT_END(OP_STREAM_SPMV, COMPRESSED_BYTES(S->nr, S->nnz) + VECTOR_BYTES(S->nr, S->nc), S->nnz);
+	return status;
+}
+
+
+typedef struct {
+	TriangleType 		uplo;
+	int 				fd;
+	const BinaryHeader 	*header;
+	index_t 			*ia;			//row pointers of the triangle, resident
+	index_t 			nnz;			//entries written so far
+	index_t 			*ja;			//entries of the current panel
+	double 				*a;
+	uint64_t 			ja_checksum;
+	uint64_t 			a_checksum;
+	int 				failed;
+} TriangleArgs;
+
+
+//Filters one panel and appends its entries to the column and value sections of the output
+static void triangle_panel(const SparseMatrix *panel, index_t row_begin, void *arg) {
+
+	TriangleArgs *args = (TriangleArgs *)arg;
+	if (args->failed) {
+		return;
+	}
+
+	index_t k = 0;
+	for (index_t i = 0; i < panel->nr; i++) {
+
+		index_t row = row_begin + i;
+		for (index_t j = panel->ia[i]; j < panel->ia[i + 1]; j++) {
+
+			index_t col = panel->ja[j];
+			if ((args->uplo == TRIANGLE_LOWER) ? (col <= row) : (col >= row)) {
+				args->ja[k] = col;
+				args->a[k] 	= panel->a[j];
+				k++;
+			}
+		}
+		args->ia[row + 1] = args->nnz + k;
+	}
+
+	off_t ja_offset = args->header->ja_offset + (off_t)args->nnz * INDEX_SIZE;
+	off_t a_offset 	= args->header->a_offset + (off_t)args->nnz * DOUBLE_SIZE;
+
+	if ((pwrite_full(args->fd, args->ja, (size_t)k * INDEX_SIZE, ja_offset) != 0) ||
+		(pwrite_full(args->fd, args->a, (size_t)k * DOUBLE_SIZE, a_offset) != 0)) {
+		args->failed = 1;
+		return;
+	}
+
+	args->ja_checksum 	= binary_checksum(args->ja_checksum, args->ja, (size_t)k * INDEX_SIZE);
+	args->a_checksum 	= binary_checksum(args->a_checksum, args->a, (size_t)k * DOUBLE_SIZE);
+	args->nnz 			+= k;
+}
+
+
+/**
+ * Writes the sections that are only known at the end, then the header, and trims the file
+ * after the value section.*/
+static int finish_container(int fd, BinaryHeader *header, const index_t *ptr, uint64_t ptr_offset, uint64_t ptr_length) {
+
+	uint64_t checksum = binary_checksum(BINARY_CHECKSUM_SEED, ptr, ptr_length * INDEX_SIZE);
+	if (ptr_offset == header->ia_offset) {
+		header->ia_checksum = checksum;
+	}
+	else {
+		header->ja_checksum = checksum;
+	}
+
+	if ((pwrite_full(fd, ptr, ptr_length * INDEX_SIZE, ptr_offset) != 0) ||
+		(ftruncate(fd, header->a_offset + header->nnz * DOUBLE_SIZE) != 0) ||
+		(pwrite_full(fd, header, sizeof(BinaryHeader), 0) != 0)) {
+		return -1;
+	}
+	return 0;
+}
+
+
+int stream_extract_triangular(StreamedMatrix *S, TriangleType uplo, const char *filename) {
+
+	INSTRUMENT_BEGIN();
+
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot open '%s' for writing.\n", filename);
+		return -1;
+	}
+
+	//The sections are laid out for all the entries of the matrix, the most the triangle can have
+	BinaryHeader header;
+	init_binary_header(&header, FORMAT_CSR, S->nr, S->nc, S->nnz, (uint64_t)S->nr + 1, S->nnz);
+
+	TriangleArgs args;
+	memset(&args, 0, sizeof(args));
+	args.uplo 			= uplo;
+	args.fd 			= fd;
+	args.header 		= &header;
+	args.ja_checksum 	= BINARY_CHECKSUM_SEED;
+	args.a_checksum 	= BINARY_CHECKSUM_SEED;
+	args.ia 			= malloc(((size_t)S->nr + 1) * INDEX_SIZE);
+	args.ja 			= malloc(((size_t)S->max_panel_nnz + 1) * INDEX_SIZE);
+	args.a 				= malloc(((size_t)S->max_panel_nnz + 1) * DOUBLE_SIZE);
+	IS_POINTER_VALID(args.ia);
+	IS_POINTER_VALID(args.ja);
+	IS_POINTER_VALID(args.a);
+	args.ia[0] = 0;
+
+	int status = stream_row_panels(S, 1, triangle_panel, &args);
+	if ((status == 0) && args.failed) {
+		status = -1;
+	}
+
+	if (status == 0) {
+		header.nnz 			= args.nnz;
+		header.ja_length 	= args.nnz;
+		header.ja_checksum 	= args.ja_checksum;
+		header.a_checksum 	= args.a_checksum;
+		status = finish_container(fd, &header, args.ia, header.ia_offset, (uint64_t)S->nr + 1);
+	}
+	if (close(fd) != 0) {
+		status = -1;
+	}
+	if (status != 0) {
+		fprintf(stderr, "Cannot write '%s'.\n", filename);
+	}
+
+	free(args.ia);
+	free(args.ja);
+	free(args.a);
+
+	INSTRUMENT_END(OP_STREAM_TRIANGULAR, COMPRESSED_BYTES(S->nr, S->nnz) + COMPRESSED_BYTES(S->nr, args.nnz), S->nnz);
+	return status;
+}
+
+
+//Entry of the matrix in the scratch file of the transpose
+typedef struct {
+	index_t 	row;
+	index_t 	col;
+	double 		val;
+} BucketEntry;
+
+
+typedef struct {
+	int 			fd;					//scratch file
+	const index_t 	*col_ptr;
+	const index_t 	*bucket_col;		//first column of every bucket, length (nbuckets + 1)
+	index_t 		nbuckets;
+	BucketEntry 	*buffer;			//write buffers, per_bucket entries each
+	index_t 		per_bucket;
+	index_t 		*fill;				//entries in the write buffer of every bucket
+	index_t 		*written;			//entries of every bucket already in the scratch file
+	int 			failed;
+} ScatterArgs;
+
+
+static void count_columns_panel(const SparseMatrix *panel, index_t row_begin, void *arg) {
+
+	index_t *count = (index_t *)arg;
+	(void)row_begin;
+
+	for (index_t j = 0; j < panel->nnz; j++) {
+		count[panel->ja[j] + 1]++;
+	}
+}
+
+
+static void flush_bucket(ScatterArgs *args, index_t b) {
+
+	off_t offset = ((off_t)args->col_ptr[args->bucket_col[b]] + args->written[b]) * (off_t)sizeof(BucketEntry);
+
+	if (pwrite_full(args->fd, args->buffer + (size_t)b * args->per_bucket, (size_t)args->fill[b] * sizeof(BucketEntry), offset) != 0) {
+		args->failed = 1;
+	}
+	args->written[b] 	+= args->fill[b];
+	args->fill[b] 		= 0;
+}
+
+
+//Appends the entries of a panel to their buckets; the buckets receive their entries in row order
+static void scatter_panel(const SparseMatrix *panel, index_t row_begin, void *arg) {
+
+	ScatterArgs *args = (ScatterArgs *)arg;
+
+	for (index_t i = 0; i < panel->nr; i++) {
+		for (index_t j = panel->ia[i]; j < panel->ia[i + 1]; j++) {
+
+			index_t col = panel->ja[j];
+			index_t b 	= (index_t)INDEX_TYPED(lower_bound)(args->bucket_col, (size_t)args->nbuckets + 1, col + 1) - 1;
+
+			BucketEntry *entry 	= args->buffer + (size_t)b * args->per_bucket + args->fill[b]++;
+			entry->row 			= row_begin + i;
+			entry->col 			= col;
+			entry->val 			= panel->a[j];
+
+			if (args->fill[b] == args->per_bucket) {
+				flush_bucket(args, b);
+			}
+		}
+	}
+}
+
+
+int stream_transpose_to_file(StreamedMatrix *S, const char *filename) {
+
+	INSTRUMENT_BEGIN();
+
+	index_t nc 		= S->nc;
+	int 	status 	= 0;
+
+	//Step 1: column counts, from the column indices only
+	index_t *col_ptr = calloc((size_t)nc + 1, INDEX_SIZE);
+	IS_POINTER_VALID(col_ptr);
+
+	if (stream_row_panels(S, 0, count_columns_panel, col_ptr) != 0) {
+		free(col_ptr);
+		return -1;
+	}
+	for (index_t c = 0; c < nc; c++) {
+		col_ptr[c + 1] += col_ptr[c];
+	}
+
+	//Step 2: buckets of consecutive columns that can be sorted within the budget
+	size_t entry_bytes 	= sizeof(BucketEntry) + INDEX_SIZE + DOUBLE_SIZE;
+	index_t nbuckets 	= split_ranges(col_ptr, nc, INDEX_SIZE, entry_bytes, S->budget, NULL);
+	if (nbuckets < 0) {
+		fprintf(stderr, "Transpose: a column does not fit in a memory budget of %zu bytes.\n", S->budget);
+		free(col_ptr);
+		return -1;
+	}
+
+	index_t *bucket_col = malloc(((size_t)nbuckets + 1) * INDEX_SIZE);
+	IS_POINTER_VALID(bucket_col);
+	split_ranges(col_ptr, nc, INDEX_SIZE, entry_bytes, S->budget, bucket_col);
+
+	//The scratch file is unlinked at once, so that it disappears with its descriptor
+	char scratch[4096];
+	snprintf(scratch, sizeof(scratch), "%s.scratch", filename);
+	int scratch_fd 	= open(scratch, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	int out_fd 		= open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (scratch_fd >= 0) {
+		unlink(scratch);
+	}
+	if ((scratch_fd < 0) || (out_fd < 0)) {
+		fprintf(stderr, "Cannot open '%s' for writing.\n", (out_fd < 0) ? filename : scratch);
+		status = -1;
+	}
+
+	//Step 3: scatter the entries into their buckets, through write buffers sharing half of the budget
+	if (status == 0) {
+
+		ScatterArgs args;
+		memset(&args, 0, sizeof(args));
+		args.fd 			= scratch_fd;
+		args.col_ptr 		= col_ptr;
+		args.bucket_col 	= bucket_col;
+		args.nbuckets 		= nbuckets;
+		args.per_bucket 	= (index_t)(S->budget / 2 / sizeof(BucketEntry) / ((size_t)nbuckets + 1));
+		args.per_bucket 	= (args.per_bucket < 1) ? 1 : args.per_bucket;
+		args.buffer 		= malloc((size_t)nbuckets * args.per_bucket * sizeof(BucketEntry) + 1);
+		args.fill 			= calloc((size_t)nbuckets + 1, INDEX_SIZE);
+		args.written 		= calloc((size_t)nbuckets + 1, INDEX_SIZE);
+		IS_POINTER_VALID(args.buffer);
+		IS_POINTER_VALID(args.fill);
+		IS_POINTER_VALID(args.written);
+
+		status = stream_row_panels(S, 1, scatter_panel, &args);
+		for (index_t b = 0; (status == 0) && (b < nbuckets); b++) {
+			flush_bucket(&args, b);
+		}
+		if (args.failed) {
+			status = -1;
+		}
+
+		free(args.buffer);
+		free(args.fill);
+		free(args.written);
+	}
+
+	//Step 4: sort every bucket by column, stably, and write it to its place in the CSC container
+	BinaryHeader header;
+	init_binary_header(&header, FORMAT_CSC, S->nr, nc, S->nnz, S->nnz, (uint64_t)nc + 1);
+	header.ia_checksum 	= BINARY_CHECKSUM_SEED;
+	header.a_checksum 	= BINARY_CHECKSUM_SEED;
+
+	if (status == 0) {
+
+		index_t max_entries = 0;
+		index_t max_cols 	= 0;
+		for (index_t b = 0; b < nbuckets; b++) {
+			index_t entries = col_ptr[bucket_col[b + 1]] - col_ptr[bucket_col[b]];
+			max_entries 	= (entries > max_entries) ? entries : max_entries;
+			max_cols 		= (bucket_col[b + 1] - bucket_col[b] > max_cols) ? bucket_col[b + 1] - bucket_col[b] : max_cols;
+		}
+
+		BucketEntry *entries 	= malloc((size_t)max_entries * sizeof(BucketEntry) + 1);
+		index_t 	*rows 		= malloc((size_t)max_entries * INDEX_SIZE + 1);
+		double 		*vals 		= malloc((size_t)max_entries * DOUBLE_SIZE + 1);
+		index_t 	*position 	= malloc((size_t)max_cols * INDEX_SIZE + 1);
+		IS_POINTER_VALID(entries);
+		IS_POINTER_VALID(rows);
+		IS_POINTER_VALID(vals);
+		IS_POINTER_VALID(position);
+
+		for (index_t b = 0; (b < nbuckets) && (status == 0); b++) {
+
+			index_t c0 		= bucket_col[b];
+			index_t first 	= col_ptr[c0];
+			index_t n 		= col_ptr[bucket_col[b + 1]] - first;
+
+			if (pread_full(scratch_fd, entries, (size_t)n * sizeof(BucketEntry), (off_t)first * sizeof(BucketEntry)) != 0) {
+				status = -1;
+				break;
+			}
+
+			for (index_t c = c0; c < bucket_col[b + 1]; c++) {
+				position[c - c0] = col_ptr[c] - first;
+			}
+			for (index_t k = 0; k < n; k++) {
+				index_t q 	= position[entries[k].col - c0]++;
+				rows[q] 	= entries[k].row;
+				vals[q] 	= entries[k].val;
+			}
+
+			if ((pwrite_full(out_fd, rows, (size_t)n * INDEX_SIZE, header.ia_offset + (off_t)first * INDEX_SIZE) != 0) ||
+				(pwrite_full(out_fd, vals, (size_t)n * DOUBLE_SIZE, header.a_offset + (off_t)first * DOUBLE_SIZE) != 0)) {
+				status = -1;
+			}
+			header.ia_checksum 	= binary_checksum(header.ia_checksum, rows, (size_t)n * INDEX_SIZE);
+			header.a_checksum 	= binary_checksum(header.a_checksum, vals, (size_t)n * DOUBLE_SIZE);
+		}
+
+		free(entries);
+		free(rows);
+		free(vals);
+		free(position);
+	}
+
+	if (status == 0) {
+		status = finish_container(out_fd, &header, col_ptr, header.ja_offset, (uint64_t)nc + 1);
+	}
+	if (status != 0) {
+		fprintf(stderr, "Cannot write the transpose to '%s'.\n", filename);
+	}
+
+	if (scratch_fd >= 0) {
+		close(scratch_fd);
+	}
+	if ((out_fd >= 0) && (close(out_fd) != 0)) {
+		status = -1;
+	}
+	free(col_ptr);
+	free(bucket_col);
+
+	INSTRUMENT_END(OP_STREAM_TRANSPOSE, 3 * COMPRESSED_BYTES(S->nr, S->nnz) + 2 * (uint64_t)S->nnz * sizeof(BucketEntry), S->nnz);
+	return status;
+}
@@ -0,0 +1,136 @@
+
+/*
+ * This project presents the implementation of basic sparse matrix operations.
+ *
+ * Copyright (C) 2024, Rico Morasata.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * DISCLAIMER OF LIABILITY
+ *
+ * THIS SOFTWARE IS PROVIDED BY RICO MORASATA "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL RICO MORASATA BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "symmetric.h"
+#include "instrument.h"
+
+
+int convert_CSR_to_symmetric(SparseMatrix *CSR, SymmetricMatrix *SYM, double rtol) {
+
+	if (!is_numerically_symmetric(CSR, rtol)) {
+		return -1;
+	}
+
+	extract_upper_triangular(CSR, &SYM->upper);
+	return 0;
+}
+
+
+void spmv_symmetric(const SymmetricMatrix *SYM, const double *x, double *y) {
+
+	INSTRUMENT_BEGIN();
+
+	const index_t 	*ia = SYM->upper.ia;
+	const index_t 	*ja = SYM->upper.ja;
+	const double 	*a 	= SYM->upper.a;
+	index_t 		nr 	= SYM->upper.nr;
+
+	int max_threads = get_max_threads();
+	double 	*buffer[max_threads];
+	index_t block_end[max_threads];
+	index_t buffer_end[max_threads];
+
+	#pragma omp parallel num_threads(max_threads) if (SYM->upper.nnz > PARALLEL_NNZ_THRESHOLD)
+	{
+		int nthreads 	= get_num_threads();
+		int tid 		= get_thread_num();
+		index_t begin 	= nnz_balanced_row_split(ia, nr, tid, nthreads);
+		index_t end 	= nnz_balanced_row_split(ia, nr, tid + 1, nthreads);
+
+		//Step 1: the buffer covers the columns beyond the block, up to the largest one reached
+		index_t last = end;
+		for (index_t i = begin; i < end; i++) {
+			if ((ia[i + 1] > ia[i]) && (ja[ia[i + 1] - 1] + 1 > last)) {
+				last = ja[ia[i + 1] - 1] + 1;
+			}
+		}
+
+		double *buf = calloc((size_t)(last - end) + 1, DOUBLE_SIZE);
+		IS_POINTER_VALID(buf);
+		buffer[tid] 	= buf;
+		block_end[tid] 	= end;
+		buffer_end[tid] = last;
+
+		memset(y + begin, 0, (size_t)(end - begin) * DOUBLE_SIZE);
+
+		//Step 2: row i gathers a_ij * x_j, and scatters a_ij * x_i to row j
+		for (index_t i = begin; i < end; i++) {
+
+			double 	xi 	= x[i];
+			double 	sum = 0.0;
+
+			for (index_t j = ia[i]; j < ia[i + 1]; j++) {
+
+				index_t col = ja[j];
+				sum += a[j] * x[col];
+
+				if (col == i) {
+					continue;
+				}
+				if (col < end) {
+					y[col] += a[j] * xi;
+				}
+				else {
+					buf[col - end] += a[j] * xi;
+				}
+			}
+			y[i] += sum;
+		}
+
+		#pragma omp barrier
+
+		//Step 3: each thread adds to its rows the buffers of the threads before it, in order
+		for (int t = 0; t < tid; t++) {
+
+			index_t lo = (block_end[t] > begin) ? block_end[t] : begin;
+			index_t hi = (buffer_end[t] < end) ? buffer_end[t] : end;
+
+			for (index_t i = lo; i < hi; i++) {
+				y[i] += buffer[t][i - block_end[t]];
+			}
+		}
+
+		#pragma omp barrier
+
+		free(buf);
+	}
+
+	INSTRUMENT_END(OP_SPMV_SYMMETRIC, COMPRESSED_BYTES(SYM->upper.nr, SYM->upper.nnz) + VECTOR_BYTES(SYM->upper.nr, SYM->upper.nc), SYM->upper.nnz);
+}
+
+
+void deallocate_symmetric_matrix(SymmetricMatrix *SYM) {
+
+	deallocate_sparse_matrix(&SYM->upper);
+}
@@ -33,6 +33,9 @@
 
 
 #include "utilities.h"
+#include "parallel.h"
+
+#include <sys/mman.h>
 
 int compare_int(const void *v1, const void *v2) {
 
@@ -71,10 +74,22 @@ void reverse_array(void *arr, size_t n, size_t element_size) {
 }
 
 
+//The generic functions dispatch to the typed kernels for the built-in comparators
+#define IS_INT_ARRAY(comp, element_size) 		((comp == compare_int) && (element_size == sizeof(int32_t)))
+#define IS_DOUBLE_ARRAY(comp, element_size) 	((comp == compare_double) && (element_size == sizeof(double)))
+
+
 int is_sorted_ascending(void *arr, size_t n, size_t element_size, comparator comp) {
 
+	if (IS_INT_ARRAY(comp, element_size)) {
+		return is_sorted_ascending_int32(arr, n);
+	}
+	if (IS_DOUBLE_ARRAY(comp, element_size)) {
+		return is_sorted_ascending_double(arr, n);
+	}
+
 	char *base = (char *)arr;
-	for (size_t i = 0; i < n - 1; i++) {
+	for (size_t i = 0; i + 1 < n; i++) {
 
 		if (comp(base + i * element_size, base + (i + 1) * element_size) > 0) {
 			return 0;
@@ -85,8 +100,15 @@ int is_sorted_ascending(void *arr, size_t n, size_t element_size, comparator com
 
 int is_sorted_descending(void *arr, size_t n, size_t element_size, comparator comp) {
 
+	if (IS_INT_ARRAY(comp, element_size)) {
+		return is_sorted_descending_int32(arr, n);
+	}
+	if (IS_DOUBLE_ARRAY(comp, element_size)) {
+		return is_sorted_descending_double(arr, n);
+	}
+
 	char *base = (char *)arr;
-	for (size_t i = 0; i < n - 1; i++) {
+	for (size_t i = 0; i + 1 < n; i++) {
 
 		if (comp(base + i * element_size, base + (i + 1) * element_size) < 0) {
 			return 0;
@@ -115,7 +137,22 @@ int is_sorted(void *arr, size_t n, size_t element_size, comparator comp) {
 
 void merge_sorted_arrays(void *arr1, size_t n1, void *arr2, size_t n2, void *arr3, size_t element_size, comparator comp, int dir) {
 
-	char temp[(n1 + n2) * element_size];
+	//arr3 may overlap the inputs, so the merge goes through a heap buffer
+	char *temp = malloc((n1 + n2) * element_size + 1);
+	IS_POINTER_VALID(temp);
+
+	if (IS_INT_ARRAY(comp, element_size)) {
+		merge_sorted_arrays_int32(arr1, n1, arr2, n2, (int32_t *)temp, dir);
+		memcpy(arr3, temp, (n1 + n2) * element_size);
+		free(temp);
+		return;
+	}
+	if (IS_DOUBLE_ARRAY(comp, element_size)) {
+		merge_sorted_arrays_double(arr1, n1, arr2, n2, (double *)temp, dir);
+		memcpy(arr3, temp, (n1 + n2) * element_size);
+		free(temp);
+		return;
+	}
 
 	size_t i = 1;
 	size_t j = 1;
@@ -150,7 +187,7 @@ void merge_sorted_arrays(void *arr1, size_t n1, void *arr2, size_t n2, void *arr
 	}
 
 	memcpy(arr3, temp, (n1 + n2) * element_size);
-
+	free(temp);
 }
 
 
@@ -168,11 +205,19 @@ int linear_search_in_range(void *arr, size_t low, size_t high, size_t element_si
 
 int binary_search_in_range(void *arr, size_t low, size_t high, size_t element_size, comparator comp, void *key, int dir) {
 
+	//The typed kernels search [low, high), while this function includes high
+	if ((dir == 1) && IS_INT_ARRAY(comp, element_size)) {
+		return binary_search_int32(arr, low, high + 1, *(int32_t *)key);
+	}
+	if ((dir == 1) && IS_DOUBLE_ARRAY(comp, element_size)) {
+		return binary_search_double(arr, low, high + 1, *(double *)key);
+	}
+
 	char *base = (char *)arr;
 
 	while (low <= high) {
 
-		int mid = low + (high - low)/2;
+		size_t mid = low + (high - low)/2;
 		if (comp(base + mid * element_size, key) == 0) {
 			return mid;
 		}
@@ -181,6 +226,9 @@ int binary_search_in_range(void *arr, size_t low, size_t high, size_t element_si
 			low = mid + 1;
 		}
 		else {
+			if (mid == 0) {
+				break;
+			}
 			high = mid - 1;
 		}
 		
@@ -196,6 +244,13 @@ void *get_max(void *arr, size_t n, size_t element_size, comparator comp, int dir
 	char 	*base = (char *)arr;
 	char 	max[element_size];
 
+	if (IS_INT_ARRAY(comp, element_size)) {
+		return base + get_max_index_int32(arr, n, dir) * element_size;
+	}
+	if (IS_DOUBLE_ARRAY(comp, element_size)) {
+		return base + get_max_index_double(arr, n, dir) * element_size;
+	}
+
 	if (dir == 1) {
 		return base + (n - 1) * element_size;
 	}
@@ -224,6 +279,13 @@ void *get_min(void *arr, size_t n, size_t element_size, comparator comp, int dir
 	char 	*base = (char *)arr;
 	char 	min[element_size];
 
+	if (IS_INT_ARRAY(comp, element_size)) {
+		return base + get_min_index_int32(arr, n, dir) * element_size;
+	}
+	if (IS_DOUBLE_ARRAY(comp, element_size)) {
+		return base + get_min_index_double(arr, n, dir) * element_size;
+	}
+
 	if (dir == 1) {
 		return base;
 	}
@@ -245,3 +307,101 @@ void *get_min(void *arr, size_t n, size_t element_size, comparator comp, int dir
 	}
 
 }
+
+
+void radix_sort_pairs(uint64_t *key, index_t *payload, size_t n, int key_bits) {
+
+	if ((n < 2) || (key_bits <= 0)) {
+		return;
+	}
+
+	uint64_t 	*key_tmp 		= malloc(n * sizeof(uint64_t));
+	index_t 	*payload_tmp 	= malloc(n * INDEX_SIZE);
+	IS_POINTER_VALID(key_tmp);
+	IS_POINTER_VALID(payload_tmp);
+
+	int max_threads = get_max_threads();
+	size_t *offsets = malloc((size_t)max_threads * RADIX_BUCKETS * sizeof(size_t));
+	IS_POINTER_VALID(offsets);
+
+	uint64_t 	*src_key = key, 	*dst_key = key_tmp;
+	index_t 	*src_pay = payload, *dst_pay = payload_tmp;
+
+	for (int shift = 0; shift < key_bits; shift += RADIX_BITS) {
+
+		#pragma omp parallel num_threads(max_threads) if (n > PARALLEL_NNZ_THRESHOLD)
+		{
+			int nthreads 	= get_num_threads();
+			int tid 		= get_thread_num();
+			size_t begin 	= n * tid / nthreads;
+			size_t end 		= n * (tid + 1) / nthreads;
+			size_t *count 	= offsets + (size_t)tid * RADIX_BUCKETS;
+
+			//Per-thread digit histogram
+			memset(count, 0, RADIX_BUCKETS * sizeof(size_t));
+			for (size_t i = begin; i < end; i++) {
+				count[(src_key[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+			}
+
+			#pragma omp barrier
+
+			//Digit-major, thread-minor prefix sum keeps the sort stable
+			#pragma omp single
+			{
+				size_t sum = 0;
+				for (int d = 0; d < RADIX_BUCKETS; d++) {
+					for (int t = 0; t < nthreads; t++) {
+						size_t c = offsets[(size_t)t * RADIX_BUCKETS + d];
+						offsets[(size_t)t * RADIX_BUCKETS + d] = sum;
+						sum += c;
+					}
+				}
+			}
+
+			for (size_t i = begin; i < end; i++) {
+				size_t pos = count[(src_key[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+				dst_key[pos] = src_key[i];
+				dst_pay[pos] = src_pay[i];
+			}
+		}
+
+		uint64_t 	*tk = src_key; src_key = dst_key; dst_key = tk;
+		index_t 	*tp = src_pay; src_pay = dst_pay; dst_pay = tp;
+	}
+
+	//After an odd number of passes, the sorted data sits in the temporary buffers
+	if (src_key != key) {
+		memcpy(key, src_key, n * sizeof(uint64_t));
+		memcpy(payload, src_pay, n * INDEX_SIZE);
+	}
+
+	free(key_tmp);
+	free(payload_tmp);
+	free(offsets);
+}
+
+
+void *allocate_aligned(size_t size, int flags) {
+
+	int huge 		= (flags & ALLOC_HUGEPAGES) && (size >= HUGEPAGE_SIZE);
+	size_t align 	= huge ? HUGEPAGE_SIZE : MEMORY_ALIGNMENT;
+	void *block 	= NULL;
+
+	//posix_memalign() rejects zero-sized requests on some systems
+	if (posix_memalign(&block, align, (size > 0) ? size : align) != 0) {
+		block = NULL;
+	}
+	IS_POINTER_VALID(block);
+
+#ifdef MADV_HUGEPAGE
+	//Only the huge pages lying entirely inside the block are advised
+	if (huge) {
+		madvise(block, (size / HUGEPAGE_SIZE) * HUGEPAGE_SIZE, MADV_HUGEPAGE);
+	}
+#endif
+
+	if (flags & ALLOC_ZERO) {
+		memset(block, 0, size);
+	}
+	return block;
+}